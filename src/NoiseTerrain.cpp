@@ -1,12 +1,19 @@
 #include "NoiseTerrain.hpp"
 #include <cassert>
+#include <cstring>
+#include <cmath>
 #include "glm/geometric.hpp"
+#include "glm/common.hpp"
 #include "globals.hpp"
+#include "viewer.hpp"
+#include <algorithm>
+#include <QGLContext>
+#include "parallel.hpp"
 
 double NoiseTerrain::noise(double x,double y)
 {
-    double floorx=(double)((int)x);//This is kinda a cheap way to floor a double integer.
-    double floory=(double)((int)y);
+    double floorx=floor(x);// (int)x arrondit vers 0, faux pour les tuiles de coordonnées négatives
+    double floory=floor(y);
     double s,t,u,v;//Integer declaration
     s=findnoise2(floorx,floory); 
     t=findnoise2(floorx+1,floory);
@@ -17,179 +24,631 @@ double NoiseTerrain::noise(double x,double y)
     return interpolate(int1,int2,y-floory);//Here we use y-floory, to get the 2nd dimension.
 }
 
-NoiseTerrain::NoiseTerrain() : m_hmap(NULL), m_w(0), m_h(0), m_normals(NULL), m_triangles(NULL)
+NoiseTerrain::NoiseTerrain() : m_hmap(NULL), m_heights(NULL), m_octNormals(NULL),
+    m_hscale(1.f), m_hoffset(0.f), m_file(NULL),
+    m_layers(), m_zoom(0.0), m_persistence(0.0), m_chunks(), m_nbChunksX(0), m_nbChunksY(0),
+    m_nbTriangles(0), m_viewer(NULL),
+    m_vbo(QGLBuffer::VertexBuffer), m_ibo(QGLBuffer::IndexBuffer),
+    m_dirty(false), m_indicesDirty(false), m_useVBO(false), m_chunkIndices(0),
+    m_indexSource(this), m_tileX(0), m_tileY(0), m_ox(0), m_oy(0), m_nbLayers(0),
+    m_w(0), m_h(0)
 {}
 
 NoiseTerrain::~NoiseTerrain()
 {
-    if (m_hmap)
-        delete[] m_hmap,
-        delete[] m_normals;
+    releaseCache();
+    delete m_file;
 }
 
-void NoiseTerrain::generateClouds(uint32_t w, uint32_t h, double zoom, double persistence, int octaves)
+void NoiseTerrain::setTile(int32_t x, int32_t y)
+{
+    m_tileX = x;
+    m_tileY = y;
+    m_zoom = 0.0; // force la régénération complète
+}
+
+void NoiseTerrain::releaseCache()
+{
+    freeLayers();
+}
+
+uint16_t NoiseTerrain::encodeNormal(const glm::vec3 &n)
+{
+    // projection sur l'octaèdre |x|+|y|+|z| = 1, l'hémisphère du bas est
+    // replié sur les coins
+    float l = fabs(n.x)+fabs(n.y)+fabs(n.z);
+    float u = n.x/l, v = n.y/l;
+    if (n.z < 0.f) {
+        float pu = u;
+        u = (1.f-fabs(v))*(pu >= 0.f ? 1.f : -1.f);
+        v = (1.f-fabs(pu))*(v >= 0.f ? 1.f : -1.f);
+    }
+    uint16_t qu = (uint16_t)floor((u*0.5f+0.5f)*255.f+0.5f),
+             qv = (uint16_t)floor((v*0.5f+0.5f)*255.f+0.5f);
+    return qu | (qv<<8);
+}
+
+glm::vec3 NoiseTerrain::decodeNormal(uint16_t e)
 {
-    // allocate heighmap
+    float u = (e&0xff)/255.f*2.f-1.f,
+          v = (e>>8)/255.f*2.f-1.f;
+    glm::vec3 n(u, v, 1.f-fabs(u)-fabs(v));
+    if (n.z < 0.f) {
+        n.x = (1.f-fabs(v))*(u >= 0.f ? 1.f : -1.f);
+        n.y = (1.f-fabs(u))*(v >= 0.f ? 1.f : -1.f);
+    }
+    return glm::normalize(n);
+}
+
+void NoiseTerrain::resize(uint32_t w, uint32_t h)
+{
+    // les données mappées ne servent plus
+    delete m_file;
+    m_file = NULL;
+    m_heights = m_octNormals = NULL;
+
+    if (w != m_w || h != m_h || m_chunks.empty())
+        m_indicesDirty = true;
     m_w = w;
     m_h = h;
-    m_hmap = new double[w*h];
-    assert(m_hmap);
+    m_ox = m_tileX*(int32_t)(w-1);
+    m_oy = m_tileY*(int32_t)(h-1);
 
-    // generate
+    // découpage en chunks
+    assert((w-1)%TERRAIN_CHUNK == 0 && (h-1)%TERRAIN_CHUNK == 0);
+    m_nbChunksX = (w-1)/TERRAIN_CHUNK;
+    m_nbChunksY = (h-1)/TERRAIN_CHUNK;
+    m_chunks.resize(m_nbChunksX*m_nbChunksY);
+    for (uint32_t cy = 0; cy < m_nbChunksY; cy++) {
+        for (uint32_t cx = 0; cx < m_nbChunksX; cx++) {
+            chunk_t &c = m_chunks[cx+cy*m_nbChunksX];
+            c.x0 = cx*TERRAIN_CHUNK;
+            c.y0 = cy*TERRAIN_CHUNK;
+            c.lod = 0;
+            c.visible = true;
+        }
+    }
+}
+
+void NoiseTerrain::quantizeHeights()
+{
+    // |noise| <= 1, donc la hauteur reste dans 0.5 +- 0.5*sum(persistence^a)
+    double range = 0;
+    for (uint32_t a = 0; a < m_nbLayers; a++)
+        range += fabs(pow(m_persistence, a));
+    m_hoffset = 0.5-0.5*range;
+    m_hscale = range > 0 ? range/65535.0 : 1.f;
+    for (uint32_t i = 0; i < m_w*m_h; i++) {
+        double q = floor((m_hmap[i]-m_hoffset)/m_hscale+0.5);
+        m_heightData[i] = (uint16_t)std::min(std::max(q, 0.0), 65535.0);
+    }
+}
+
+void NoiseTerrain::freeLayers()
+{
+    for (std::vector<double*>::iterator it(m_layers.begin()); it != m_layers.end(); ++it)
+        delete[] *it;
+    m_layers.clear();
+}
+
+void NoiseTerrain::generateLayer(uint32_t a)
+{
+    double *layer = new double[m_w*m_h];
+    assert(layer);
+    double freq = pow(2, a); // incr freq every loop
 
     for (uint32_t y = 0; y < m_h; y++) {
         for (uint32_t x = 0; x < m_w; x++) {
-            double getNoise = 0;
+            layer[x+y*m_w] = noise(static_cast<double>(m_ox+(int32_t)x)*freq/m_zoom, static_cast<double>(m_oy+(int32_t)y)*freq/m_zoom);
+        }
+    }
+    m_layers.push_back(layer);
+}
 
-            for (int a = 0; a < octaves-1; a++) {
-                double freq = pow(2, a); // incr freq every loop
-                double ampl = pow(persistence, a); // decrease ampl every loop
+void NoiseTerrain::sumLayers()
+{
+    std::vector<double> ampl(m_layers.size());
+    for (uint32_t a = 0; a < m_layers.size(); a++)
+        ampl[a] = pow(m_persistence, a); // decrease ampl every loop
 
-                getNoise += noise(static_cast<double>(x)*freq/zoom, (static_cast<double>(y)/zoom*freq)*ampl);
-            }
+    for (uint32_t i = 0; i < m_w*m_h; i++) {
+        double getNoise = 0;
+        for (uint32_t a = 0; a < m_layers.size(); a++)
+            getNoise += m_layers[a][i]*ampl[a];
+        m_hmap[i] = 0.5*getNoise+0.5;
+    }
+}
 
-            m_hmap[x+y*m_w] = 0.5*getNoise+0.5;
-        }
+double NoiseTerrain::sampleHeight(int32_t gx, int32_t gy)
+{
+    // même calcul que generateLayer + sumLayers, pour un seul point
+    double getNoise = 0;
+    for (uint32_t a = 0; a < m_nbLayers; a++) {
+        double freq = pow(2, a);
+        getNoise += noise(static_cast<double>(gx)*freq/m_zoom, static_cast<double>(gy)*freq/m_zoom)*pow(m_persistence, a);
     }
+    return 0.5*getNoise+0.5;
+}
 
+void NoiseTerrain::generateClouds(uint32_t w, uint32_t h, double zoom, double persistence, int octaves)
+{
+    uint32_t nbLayers = octaves > 1 ? octaves-1 : 0;
+
+    // seul un changement de taille ou de zoom invalide toutes les couches.
+    // Un terrain chargé depuis le cache disque n'en a aucune: on repasse
+    // sur nos vecteurs et resize démappe le fichier.
+    if (m_file || w != m_w || h != m_h || zoom != m_zoom) {
+        releaseCache();
+        resize(w, h);
+        m_zoom = zoom;
+        m_heightData.resize(w*h);
+        m_normalData.resize(w*h);
+        m_heights = &m_heightData[0];
+        m_octNormals = &m_normalData[0];
+    } else if (persistence == m_persistence && nbLayers == m_nbLayers) {
+        return; // rien n'a changé
+    }
+    m_persistence = persistence;
+    m_nbLayers = nbLayers;
+
+    // on ne génère que les octaves qui manquent, la persistance ne fait
+    // que re-pondérer les couches
+    while (m_layers.size() > nbLayers) {
+        delete[] m_layers.back();
+        m_layers.pop_back();
+    }
+    while (m_layers.size() < nbLayers)
+        generateLayer(m_layers.size());
+
+    // la heightmap en double ne vit que le temps de quantifier les
+    // hauteurs et de calculer les normales
+    m_hmap = new double[w*h];
+    assert(m_hmap);
+    sumLayers();
+    quantizeHeights();
     computeNormals();
+    delete[] m_hmap;
+    m_hmap = NULL;
+
+    computeBounds();
+    m_dirty = true;
 }
 
-void NoiseTerrain::drawHMap()
+// en-tête du cache disque, suivi des hauteurs puis des normales (w*h
+// uint16_t chacun), dans l'ordre des octets de la machine
+struct terrain_cache_t {
+    char magic[4];
+    uint32_t version; // à changer si la génération change
+    uint32_t w, h;
+    int32_t tileX, tileY;
+    double zoom, persistence;
+    uint32_t nbLayers;
+    float hscale, hoffset;
+};
+#define TERRAIN_CACHE_VERSION 1
+
+bool NoiseTerrain::save(const char *path) const
 {
-    glPushMatrix();
+    if (!m_heights)
+        return false;
+    terrain_cache_t head;
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, "NTRN", 4);
+    head.version = TERRAIN_CACHE_VERSION;
+    head.w = m_w;
+    head.h = m_h;
+    head.tileX = m_tileX;
+    head.tileY = m_tileY;
+    head.zoom = m_zoom;
+    head.persistence = m_persistence;
+    head.nbLayers = m_nbLayers;
+    head.hscale = m_hscale;
+    head.hoffset = m_hoffset;
 
-    glPopMatrix();
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        std::cerr<<"Cannot write terrain cache "<<path<<"\n";
+        return false;
+    }
+    qint64 size = m_w*m_h*sizeof(uint16_t);
+    bool ok = f.write((const char*)&head, sizeof(head)) == sizeof(head) &&
+              f.write((const char*)m_heights, size) == size &&
+              f.write((const char*)m_octNormals, size) == size;
+    f.close();
+    return ok;
 }
 
-float NoiseTerrain::getZ(float x, float y)
+bool NoiseTerrain::load(const char *path, uint32_t w, uint32_t h, double zoom, double persistence, int octaves)
+{
+    QFile *f = new QFile(path);
+    const qint64 size = w*h*sizeof(uint16_t);
+    const uchar *data = NULL;
+    if (f->open(QIODevice::ReadOnly) && f->size() == (qint64)sizeof(terrain_cache_t)+2*size)
+        data = f->map(0, f->size());
+    const terrain_cache_t *head = (const terrain_cache_t*)data;
+    if (!head || memcmp(head->magic, "NTRN", 4) != 0 || head->version != TERRAIN_CACHE_VERSION ||
+            head->w != w || head->h != h || head->tileX != m_tileX || head->tileY != m_tileY ||
+            head->zoom != zoom || head->persistence != persistence ||
+            head->nbLayers != (uint32_t)(octaves > 1 ? octaves-1 : 0)) {
+        delete f;
+        return false;
+    }
+
+    releaseCache();
+    resize(w, h);
+    std::vector<uint16_t>().swap(m_heightData);
+    std::vector<uint16_t>().swap(m_normalData);
+    m_file = f;
+    m_heights = (const uint16_t*)(data+sizeof(terrain_cache_t));
+    m_octNormals = m_heights+w*h;
+    m_zoom = zoom;
+    m_persistence = persistence;
+    m_nbLayers = head->nbLayers;
+    m_hscale = head->hscale;
+    m_hoffset = head->hoffset;
+    computeBounds();
+    m_dirty = true;
+    return true;
+}
+
+void NoiseTerrain::computeBounds()
 {
-    x/=TERRAIN_WIDTH;
-    x+=0.5;
-    x*=m_w;
-    y/=TERRAIN_HEIGHT;
-    y+=0.5;
-    y*=m_h;
-    float px = x-floor(x);
-    float py = y-floor(y);
-    float p = (px+py)/2.f;
+    for (std::vector<chunk_t>::iterator it(m_chunks.begin()); it != m_chunks.end(); ++it) {
+        float zmin = height(it->x0+it->y0*m_w),
+              zmax = zmin;
+        for (uint32_t y = it->y0; y <= it->y0+TERRAIN_CHUNK; y++) {
+            for (uint32_t x = it->x0; x <= it->x0+TERRAIN_CHUNK; x++) {
+                zmin = std::min(zmin, height(x+y*m_w));
+                zmax = std::max(zmax, height(x+y*m_w));
+            }
+        }
+        // les jupes descendent de toute la hauteur du chunk
+        it->skirt = -(zmax-zmin)-1.f;
+        zmin += it->skirt;
+        it->min = glm::vec3(((double)(m_ox+(int32_t)it->x0)/m_w-0.5)*TERRAIN_WIDTH,
+                            ((double)(m_oy+(int32_t)it->y0)/m_h-0.5)*TERRAIN_HEIGHT, zmin);
+        it->max = glm::vec3(((double)(m_ox+(int32_t)it->x0+TERRAIN_CHUNK)/m_w-0.5)*TERRAIN_WIDTH,
+                            ((double)(m_oy+(int32_t)it->y0+TERRAIN_CHUNK)/m_h-0.5)*TERRAIN_HEIGHT, zmax);
+    }
+}
+
+void NoiseTerrain::updateChunks()
+{
+    if (!m_viewer) {
+        for (std::vector<chunk_t>::iterator it(m_chunks.begin()); it != m_chunks.end(); ++it)
+            it->visible = true,
+            it->lod = 0;
+        return;
+    }
+
+    // plans du frustum: a*x+b*y+c*z-d > 0 pour un point à l'extérieur
+    GLdouble planes[6][4];
+    const qglviewer::Camera *cam = m_viewer->camera();
+    cam->getFrustumPlanesCoefficients(planes);
+    qglviewer::Vec eye(cam->position());
 
-    return m_hmap[(int)x+((int)y)*m_w]*p+
-           m_hmap[(int)x+1+((int)y+1)*m_w]*(1-p);
+    for (std::vector<chunk_t>::iterator it(m_chunks.begin()); it != m_chunks.end(); ++it) {
+        it->visible = true;
+        for (int i = 0; i < 6 && it->visible; i++) {
+            // sommet de la boîte le plus à l'intérieur du plan
+            glm::vec3 p(planes[i][0] > 0 ? it->min.x : it->max.x,
+                        planes[i][1] > 0 ? it->min.y : it->max.y,
+                        planes[i][2] > 0 ? it->min.z : it->max.z);
+            if (planes[i][0]*p.x + planes[i][1]*p.y + planes[i][2]*p.z - planes[i][3] > 0)
+                it->visible = false;
+        }
+        if (!it->visible)
+            continue;
+
+        // distance de la caméra au point le plus proche de la boîte
+        glm::vec3 e(eye.x, eye.y, eye.z),
+                  closest(glm::clamp(e, it->min, it->max));
+        float d = glm::length(e - closest);
+        uint32_t lod = 0;
+        for (float l = TERRAIN_LOD_DIST; d > l && lod < TERRAIN_LOD_COUNT-1; l *= 2.f)
+            lod++;
+        it->lod = lod;
+    }
 }
 
+void NoiseTerrain::buildVertices()
+{
+    const uint32_t stride = 8;
+    m_vertexData.resize((m_w*m_h + m_chunks.size()*4*(TERRAIN_CHUNK+1))*stride);
+    GLfloat *v = &m_vertexData[0];
 
-void NoiseTerrain::triangle_t::computeNormal(uint32_t w, uint32_t h) {
-    for (uint32_t i = 0; i < 3; i++)
-        vx[i].x /= (double)w,
-        vx[i].y /= (double)h;
-    normal = glm::normalize(glm::cross(vx[1]-vx[2], vx[0]-vx[2]));
+    for (uint32_t y = 0; y < m_h; y++) {
+        for (uint32_t x = 0; x < m_w; x++, v += stride) {
+            const glm::vec3 n(normal(x+y*m_w));
+            v[0] = ((double)(m_ox+(int32_t)x)/m_w-0.5)*TERRAIN_WIDTH;
+            v[1] = ((double)(m_oy+(int32_t)y)/m_h-0.5)*TERRAIN_HEIGHT;
+            v[2] = height(x+y*m_w);
+            v[3] = n.x;
+            v[4] = n.y;
+            v[5] = n.z;
+            v[6] = (m_ox+(int32_t)x)/((float)m_w)*TERRAIN_TEX_REPS;
+            v[7] = (m_oy+(int32_t)y)/((float)m_h)*TERRAIN_TEX_REPS;
+        }
+    }
+
+    // jupes: copie des sommets du bord, descendus de c.skirt
+    for (uint32_t c = 0; c < m_chunks.size(); c++) {
+        const chunk_t &ch = m_chunks[c];
+        for (uint32_t e = 0; e < 4; e++) {
+            for (uint32_t i = 0; i <= TERRAIN_CHUNK; i++, v += stride) {
+                uint32_t x = e < 2 ? ch.x0+i : ch.x0+(e-2)*TERRAIN_CHUNK,
+                         y = e < 2 ? ch.y0+e*TERRAIN_CHUNK : ch.y0+i;
+                for (uint32_t k = 0; k < stride; k++)
+                    v[k] = m_vertexData[(x+y*m_w)*stride+k];
+                v[2] += ch.skirt;
+            }
+        }
+    }
 }
 
-void NoiseTerrain::computeNormals()
+void NoiseTerrain::buildIndices()
 {
-    // clé indice dans m_hmap;
-    // pour chaque point liste des triangles qui le contient
-    if (m_triangles) {
-        for (std::list<triangle_t*>::iterator it(m_trianglePool.begin()); it != m_trianglePool.end(); ++it)
-            delete *it;
-        m_trianglePool.clear();
-        delete[] m_triangles;
-    }
-    m_triangles = new std::list<triangle_t*>[m_w*m_h];
-
-    // on calcule tout les triangles et les normales de ceux-ci
-    for (uint32_t y = 0; y < m_h-1; ++y) {
-        for (uint32_t x = 0; x < m_w; ++x) {
-            triangle_t* t = NULL;
-            if (x < m_w-1) {
-                t = new triangle_t;
-                assert(t);
-                t->vx[0] = glm::vec3((x-0.5)*TERRAIN_WIDTH, (y-0.5)*TERRAIN_HEIGHT, m_hmap[x+y*m_w]);
-                t->vx[1] = glm::vec3((x-0.5)*TERRAIN_WIDTH, (y+1-0.5)*TERRAIN_HEIGHT, m_hmap[x+(1+y)*m_w]);
-                t->vx[2] = glm::vec3((x+1-0.5)*TERRAIN_WIDTH, (y-0.5)*TERRAIN_HEIGHT, m_hmap[x+1+y*m_w]);
-
-                m_triangles[x+y*m_w].push_back(t);
-                m_triangles[x+1+y*m_w].push_back(t);
-                m_triangles[x+(y+1)*m_w].push_back(t);
-                m_trianglePool.push_back(t);
-                
-                t->computeNormal(m_w, m_h);
+    // même nombre d'indices pour chaque chunk à un lod donné
+    m_chunkIndices = 0;
+    for (uint32_t l = 0; l < TERRAIN_LOD_COUNT; l++) {
+        uint32_t n = TERRAIN_CHUNK>>l;
+        m_lodOffset[l] = m_chunkIndices;
+        m_lodCount[l] = 6*n*n + 4*6*n;
+        m_chunkIndices += m_lodCount[l];
+    }
+    m_indexData.resize(m_chunks.size()*m_chunkIndices);
+    GLuint *ind = &m_indexData[0];
+
+    for (uint32_t c = 0; c < m_chunks.size(); c++) {
+        const chunk_t &ch = m_chunks[c];
+        for (uint32_t l = 0; l < TERRAIN_LOD_COUNT; l++) {
+            const uint32_t step = 1<<l;
+            for (uint32_t y = ch.y0; y < ch.y0+TERRAIN_CHUNK; y += step) {
+                for (uint32_t x = ch.x0; x < ch.x0+TERRAIN_CHUNK; x += step) {
+                    GLuint a = x+y*m_w, b = a+step,
+                           d = a+step*m_w, e = d+step;
+                    *ind++ = a; *ind++ = d; *ind++ = b;
+                    *ind++ = b; *ind++ = d; *ind++ = e;
+                }
             }
-            if (x > 0) {
-                t = NULL;
-                t = new triangle_t;
-                assert(t);
-                t->vx[2] = glm::vec3((x-0.5)*TERRAIN_WIDTH, (y-0.5)*TERRAIN_HEIGHT, m_hmap[x+y*m_w]);
-                t->vx[1] = glm::vec3((x-0.5)*TERRAIN_WIDTH, (y+1-0.5)*TERRAIN_HEIGHT, m_hmap[x+(1+y)*m_w]);
-                t->vx[0] = glm::vec3((x-1-0.5)*TERRAIN_WIDTH, (y-0.5)*TERRAIN_HEIGHT, m_hmap[x-1+y*m_w]);
-
-                m_triangles[x+y*m_w].push_back(t);
-                m_triangles[x-1+y*m_w].push_back(t);
-                m_triangles[x+(y+1)*m_w].push_back(t);
-                m_trianglePool.push_back(t);
-
-                t->computeNormal(m_w, m_h);
+            for (uint32_t e = 0; e < 4; e++) {
+                for (uint32_t i = 0; i < TERRAIN_CHUNK; i += step) {
+                    GLuint t0 = e < 2 ? ch.x0+i + (ch.y0+e*TERRAIN_CHUNK)*m_w
+                                      : ch.x0+(e-2)*TERRAIN_CHUNK + (ch.y0+i)*m_w,
+                           t1 = e < 2 ? t0+step : t0+step*m_w,
+                           b0 = skirtIndex(c, e, i),
+                           b1 = skirtIndex(c, e, i+step);
+                    *ind++ = t0; *ind++ = b0; *ind++ = t1;
+                    *ind++ = t1; *ind++ = b0; *ind++ = b1;
+                }
             }
         }
     }
+}
+
+void NoiseTerrain::uploadBuffers()
+{
+    buildVertices();
+    if (m_indexSource != this) {
+        m_indicesDirty = false;
+        if (m_indexSource->m_dirty)
+            m_indexSource->uploadBuffers();
+    }
+    if (m_indicesDirty)
+        buildIndices();
 
-    // on interpole les normale des triangles contenant chaque point
-    if (m_normals)
-        delete[] m_normals;
-    m_normals = new glm::vec3[m_w*m_h];
-    for (uint32_t y = 0; y < m_h; ++y) {
-        for (uint32_t x = 0; x < m_w; ++x) {
-            glm::vec3 sum;
-            std::list<triangle_t*> *l = &m_triangles[x+y*m_w];
-            for (std::list<triangle_t*>::iterator it(l->begin()); it != l->end(); ++it) {
-                sum += (*it)->normal;
+    // sans VBO on garde les tableaux côté client
+    if (!m_vbo.isCreated())
+        m_useVBO = m_vbo.create() && m_ibo.create();
+    if (m_useVBO) {
+        m_vbo.bind();
+        m_vbo.allocate(&m_vertexData[0], m_vertexData.size()*sizeof(GLfloat));
+        m_vbo.release();
+        std::vector<GLfloat>().swap(m_vertexData);
+        if (m_indicesDirty) {
+            m_ibo.bind();
+            m_ibo.allocate(&m_indexData[0], m_indexData.size()*sizeof(GLuint));
+            m_ibo.release();
+            std::vector<GLuint>().swap(m_indexData);
+        }
+    }
+    m_dirty = m_indicesDirty = false;
+}
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+typedef void (APIENTRY *MultiDrawElements)(GLenum, const GLsizei*, GLenum, const GLvoid**, GLsizei);
+
+void NoiseTerrain::draw(int pass)
+{
+    if (m_chunks.empty())
+        return;
+    if (m_dirty)
+        uploadBuffers();
+
+    // la visibilité calculée pour la première passe sert aussi aux caustiques
+    if (pass == PASS_NORMAL) {
+        updateChunks();
+        m_drawCounts.clear();
+        m_drawOffsets.clear();
+        m_nbTriangles = 0;
+        const NoiseTerrain &ix = *m_indexSource;
+        const GLuint *base = ix.m_useVBO ? NULL : &ix.m_indexData[0];
+        for (uint32_t c = 0; c < m_chunks.size(); c++) {
+            if (m_chunks[c].visible) {
+                uint32_t l = m_chunks[c].lod;
+                m_drawCounts.push_back(ix.m_lodCount[l]);
+                m_drawOffsets.push_back(base + c*ix.m_chunkIndices + ix.m_lodOffset[l]);
+                m_nbTriangles += ix.m_lodCount[l]/3;
             }
-            m_normals[x+y*m_w] = glm::normalize(sum);
         }
     }
+    if (m_drawCounts.empty())
+        return;
+
+    glColor3f(1, 1, 1);
+    if (pass == PASS_NORMAL)
+        TextureManager::bindTexture("sand1");
+
+    const GLsizei stride = 8*sizeof(GLfloat);
+    const GLfloat *v = NULL;
+    if (m_useVBO)
+        m_vbo.bind();
+    else
+        v = &m_vertexData[0];
+    if (m_indexSource->m_useVBO)
+        m_indexSource->m_ibo.bind();
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, v);
+    glNormalPointer(GL_FLOAT, stride, v+3);
+    glTexCoordPointer(2, GL_FLOAT, stride, v+6);
+
+    // un seul appel pour tous les chunks visibles (GL 1.4)
+    static MultiDrawElements multiDraw = NULL;
+    static bool resolved = false;
+    if (!resolved && QGLContext::currentContext()) {
+        multiDraw = (MultiDrawElements)QGLContext::currentContext()->getProcAddress("glMultiDrawElements");
+        resolved = true;
+    }
+    if (multiDraw) {
+        multiDraw(GL_TRIANGLES, &m_drawCounts[0], GL_UNSIGNED_INT, &m_drawOffsets[0], m_drawCounts.size());
+    } else {
+        for (uint32_t i = 0; i < m_drawCounts.size(); i++)
+            glDrawElements(GL_TRIANGLES, m_drawCounts[i], GL_UNSIGNED_INT, m_drawOffsets[i]);
+    }
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    QGLBuffer::release(QGLBuffer::VertexBuffer);
+    QGLBuffer::release(QGLBuffer::IndexBuffer);
 }
 
-double* NoiseTerrain::getHMap() {
-    return m_hmap;
+void NoiseTerrain::drawHMap()
+{
+    glPushMatrix();
+
+    glPopMatrix();
 }
-/*
-void NoiseTerrain::computeNormals()
+
+#define HEIGHT_QUERY_BLOCK 64
+
+void NoiseTerrain::sampleRange(const float *x, const float *y, float *z, glm::vec3 *normals,
+        uint32_t begin, uint32_t end) const
 {
-    if (m_normals)
-        delete[] m_normals;
+    const float sx = m_w/TERRAIN_WIDTH, ox = 0.5f*m_w-m_ox,
+                sy = m_h/TERRAIN_HEIGHT, oy = 0.5f*m_h-m_oy,
+                maxX = m_w-1, maxY = m_h-1;
+    // par blocs: d'abord les coordonnées dans la grille (boucle sans
+    // branchement que le compilateur peut vectoriser), puis les lectures
+    float gx[HEIGHT_QUERY_BLOCK], gy[HEIGHT_QUERY_BLOCK];
+    for (uint32_t b = begin; b < end; b += HEIGHT_QUERY_BLOCK) {
+        const uint32_t n = std::min<uint32_t>(HEIGHT_QUERY_BLOCK, end-b);
+        for (uint32_t i = 0; i < n; i++) {
+            gx[i] = std::min(std::max(x[b+i]*sx+ox, 0.f), maxX);
+            gy[i] = std::min(std::max(y[b+i]*sy+oy, 0.f), maxY);
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            // le dernier sommet est traité comme l'interpolation à 1 de la
+            // dernière case
+            uint32_t ix = std::min((uint32_t)gx[i], m_w-2),
+                     iy = std::min((uint32_t)gy[i], m_h-2),
+                     k = ix+iy*m_w;
+            float fx = gx[i]-ix, fy = gy[i]-iy;
+            float h0 = height(k) + (height(k+1)-height(k))*fx,
+                  h1 = height(k+m_w) + (height(k+m_w+1)-height(k+m_w))*fx;
+            z[b+i] = h0 + (h1-h0)*fy;
+            if (normals) {
+                glm::vec3 n0 = glm::mix(normal(k), normal(k+1), fx),
+                          n1 = glm::mix(normal(k+m_w), normal(k+m_w+1), fx);
+                normals[b+i] = glm::normalize(glm::mix(n0, n1, fy));
+            }
+        }
+    }
+}
 
-    m_normals = new glm::vec3[m_w*m_h];
-    for (uint32_t y = 0; y < m_h; y++) {
-        for (uint32_t x = 0; x < m_w; x++) {
-            glm::vec3 a, b, c, sum;
+struct HeightQuery {
+    const NoiseTerrain &t;
+    const float *x, *y;
+    float *z;
+    glm::vec3 *normals;
+    HeightQuery(const NoiseTerrain &t, const float *x, const float *y, float *z, glm::vec3 *normals) :
+        t(t), x(x), y(y), z(z), normals(normals)
+    {}
+    void operator()(uint32_t begin, uint32_t end) const
+    {
+        t.sampleRange(x, y, z, normals, begin, end);
+    }
+};
+
+void NoiseTerrain::getZ(const float *x, const float *y, float *z, glm::vec3 *normals, uint32_t count)
+{
+    if (!m_heights || count == 0)
+        return;
+    parallelFor(count, HeightQuery(*this, x, y, z, normals), 4096);
+}
 
-            a.x = x;
-            a.y = y;
-            a.z = m_hmap[x+y*m_w];
+float NoiseTerrain::getZ(float x, float y)
+{
+    float z = 0.f;
+    if (m_heights)
+        sampleRange(&x, &y, &z, NULL, 0, 1);
+    return z;
+}
 
-            b.y = y;
-            if (x < m_w-1) 
-                b.x = x+1;
-            else
-                b.x = x-1;
-            b.z = m_hmap[(int)b.x+y*m_w];
+glm::vec3 NoiseTerrain::getNormal(float x, float y)
+{
+    float z;
+    glm::vec3 n(0.f, 0.f, 1.f);
+    if (m_heights)
+        sampleRange(&x, &y, &z, &n, 0, 1);
+    return n;
+}
 
-            c.x = x;
-            if (y < m_h-1) 
-                c.y = y+1;
-            else
-                c.y = y-1;
-            c.z = m_hmap[x+(int)c.y*m_w];
 
+double NoiseTerrain::heightAt(int32_t x, int32_t y)
+{
+    if (x >= 0 && y >= 0 && x < (int32_t)m_w && y < (int32_t)m_h)
+        return m_hmap[x+y*m_w];
+    // en dehors de la grille on échantillonne le bruit, pour que les
+    // normales des bords soient les mêmes que celles des tuiles voisines
+    return sampleHeight(m_ox+x, m_oy+y);
+}
 
-            sum += glm::cross(c - a, b - a);
+glm::vec3 NoiseTerrain::faceA(int32_t x, int32_t y)
+{
+    const float dx = TERRAIN_WIDTH/m_w, dy = TERRAIN_HEIGHT/m_h;
+    float z = heightAt(x, y), zu = heightAt(x, y+1), zr = heightAt(x+1, y);
+    return glm::normalize(glm::cross(glm::vec3(-dx, dy, zu-zr), glm::vec3(-dx, 0.f, z-zr)));
+}
 
-            m_normals[x+y*m_w] = glm::normalize(sum);
+glm::vec3 NoiseTerrain::faceB(int32_t x, int32_t y)
+{
+    const float dx = TERRAIN_WIDTH/m_w, dy = TERRAIN_HEIGHT/m_h;
+    float z = heightAt(x, y), zu = heightAt(x, y+1), zl = heightAt(x-1, y);
+    return glm::normalize(glm::cross(glm::vec3(0.f, dy, zu-z), glm::vec3(-dx, 0.f, zl-z)));
+}
 
-            if (a.x < m_w-1 && a.y < m_h-1)
-                m_normals[x+y*m_w].z *= -1.0;
+void NoiseTerrain::computeNormals()
+{
+    // Pour chaque sommet (x,y) on a deux triangles:
+    //  A: (x,y) (x,y+1) (x+1,y)
+    //  B: (x,y) (x,y+1) (x-1,y)
+    // La normale d'un sommet est la moyenne des normales des six triangles
+    // qui le contiennent, calculées à la volée. Les faces qui sortent de la
+    // grille sont échantillonnées dans le bruit, cf heightAt.
+    for (int32_t y = 0; y < (int32_t)m_h; ++y) {
+        for (int32_t x = 0; x < (int32_t)m_w; ++x) {
+            glm::vec3 sum = faceA(x, y) + faceA(x-1, y) + faceA(x, y-1) +
+                            faceB(x, y) + faceB(x+1, y) + faceB(x, y-1);
+            m_normalData[x+y*m_w] = encodeNormal(sum);
         }
     }
 }
-*/
+
+double* NoiseTerrain::getHMap() {
+    return m_hmap;
+}
@@ -18,10 +18,18 @@
 #include <cmath>
 #include <iostream>
 #include <list>
+#include <vector>
 #include "glm/vec3.hpp"
 #include "TextureManager.hpp"
+#include <QGLBuffer>
+#include <QFile>
 #include "globals.hpp"
 
+#define TERRAIN_CHUNK 16 // quads par côté d'un chunk, puissance de 2
+#define TERRAIN_LOD_COUNT 5 // log2(TERRAIN_CHUNK)+1
+#define TERRAIN_LOD_DIST 50.f // distance au delà de laquelle on passe au lod 1
+#define TERRAIN_TEX_REPS (TERRAIN_WIDTH/10.f)
+
 class NoiseTerrain : public Renderable {
 
     inline double findnoise2(double x,double y)
@@ -41,19 +49,100 @@ class NoiseTerrain : public Renderable {
 
     double noise(double x,double y);
 
-    struct triangle_t {
-        glm::vec3 vx[3];
-        glm::vec3 normal;
-
-        void computeNormal(uint32_t w, uint32_t h);
-    };
+    // génère la couche brute (non pondérée) de l'octave a
+    void generateLayer(uint32_t a);
+    // somme pondérée des couches en cache -> m_hmap, qui doit être alloué
+    void sumLayers();
+    void freeLayers();
+    // hauteur du sommet (gx,gy) de la grille globale, sans passer par le cache
+    double sampleHeight(int32_t gx, int32_t gy);
+    // hauteur locale, échantillonnée hors de la grille (bords des tuiles)
+    double heightAt(int32_t x, int32_t y);
+    glm::vec3 faceA(int32_t x, int32_t y);
+    glm::vec3 faceB(int32_t x, int32_t y);
 
     /////// VARS ///////
 
-    double *m_hmap; // 2d heighmap acces with x+y*w
-    glm::vec3 *m_normals;
-    std::list<triangle_t*> *m_triangles;
-    std::list<triangle_t*> m_trianglePool;
+    double *m_hmap; // 2d heighmap acces with x+y*w, seulement pendant la génération
+    // Stockage compact: hauteurs sur 16 bits (h = q*m_hscale + m_hoffset) et
+    // normales en octaèdre sur 2x8 bits. Les pointeurs visent soit les
+    // vecteurs, soit le fichier de cache mappé en mémoire.
+    std::vector<uint16_t> m_heightData, m_normalData;
+    const uint16_t *m_heights, *m_octNormals;
+    float m_hscale, m_hoffset;
+    QFile *m_file;
+
+    static uint16_t encodeNormal(const glm::vec3 &n);
+    static glm::vec3 decodeNormal(uint16_t e);
+    inline float height(uint32_t k) const { return m_heights[k]*m_hscale + m_hoffset; }
+    inline glm::vec3 normal(uint32_t k) const { return decodeNormal(m_octNormals[k]); }
+    // découpage en chunks pour une grille w x h
+    void resize(uint32_t w, uint32_t h);
+    // m_hmap -> m_heightData, avec une échelle qui ne dépend que des
+    // paramètres, pour que deux tuiles voisines aient les mêmes bords
+    void quantizeHeights();
+    // normales de tous les sommets depuis m_hmap: un changement de
+    // paramètre déplace tous les sommets, il n'y a pas de mise à jour
+    // partielle
+    void computeNormals();
+
+    // cache des octaves: une couche de bruit brut par octave, générée
+    // une seule fois pour un (w, h, zoom) donné. La persistance ne fait
+    // que changer le poids de chaque couche.
+    std::vector<double*> m_layers;
+    double m_zoom, m_persistence;
+
+    // Tuile (m_tileX, m_tileY): le sommet local (x,y) est le sommet
+    // (m_ox+x, m_oy+y) de la grille infinie. Deux tuiles voisines partagent
+    // leur rangée de sommets du bord.
+    int32_t m_tileX, m_tileY, m_ox, m_oy;
+    uint32_t m_nbLayers;
+
+    // Le terrain est découpé en chunks de TERRAIN_CHUNK x TERRAIN_CHUNK
+    // quads. Chaque chunk est dessiné avec un pas de 2^lod sommets selon sa
+    // distance à la caméra (geomipmapping), des jupes verticales sur les
+    // bords cachent les trous entre deux chunks de lod différents.
+    struct chunk_t {
+        uint32_t x0, y0; // premier sommet du chunk
+        glm::vec3 min, max; // boîte englobante dans le repère du monde
+        float skirt; // hauteur des jupes (négative)
+        uint32_t lod;
+        bool visible;
+    };
+    std::vector<chunk_t> m_chunks;
+    uint32_t m_nbChunksX, m_nbChunksY;
+    uint32_t m_nbTriangles;
+    Viewer *m_viewer;
+
+    // Buffers retenus: tous les sommets de la grille puis ceux des jupes
+    // (4 bords par chunk), et pour chaque (chunk, lod) une plage d'indices.
+    // Ils ne sont reconstruits que lorsque le terrain change.
+    QGLBuffer m_vbo, m_ibo;
+    bool m_dirty, m_indicesDirty, m_useVBO;
+    std::vector<GLfloat> m_vertexData; // x y z nx ny nz s t
+    std::vector<GLuint> m_indexData;
+    GLsizei m_lodOffset[TERRAIN_LOD_COUNT], // indice de début d'un lod dans un chunk
+            m_lodCount[TERRAIN_LOD_COUNT];
+    GLsizei m_chunkIndices; // nombre d'indices par chunk, tous lods confondus
+    NoiseTerrain *m_indexSource; // terrain qui possède l'index buffer (this par défaut)
+    std::vector<GLsizei> m_drawCounts;
+    std::vector<const GLvoid*> m_drawOffsets;
+
+    void computeBounds();
+    // visibilité et lod de chaque chunk, une fois par frame
+    void updateChunks();
+    void buildVertices();
+    void buildIndices();
+    void uploadBuffers();
+
+    friend struct HeightQuery;
+    // requêtes [begin, end) de getZ(x, y, z, normals, count)
+    void sampleRange(const float *x, const float *y, float *z, glm::vec3 *normals,
+            uint32_t begin, uint32_t end) const;
+
+    inline GLuint skirtIndex(uint32_t chunk, uint32_t edge, uint32_t i) const {
+        return m_w*m_h + (chunk*4+edge)*(TERRAIN_CHUNK+1) + i;
+    }
 
 public:
     // Cons dest
@@ -64,62 +153,42 @@ public:
 
     void generateClouds(uint32_t w, uint32_t h, double zoom, double persistence, int octaves);
 
+    // à appeler avant generateClouds
+    void setTile(int32_t x, int32_t y);
+    inline int32_t getTileX() const { return m_tileX; }
+    inline int32_t getTileY() const { return m_tileY; }
+    // libère les couches d'octaves, seules les hauteurs et les normales
+    // compactes restent (tuiles en arrière plan). Le terrain central les
+    // garde pour que H, J et K ne régénèrent que ce qui a changé.
+    void releaseCache();
+
+    // Cache disque: save écrit le terrain généré et ses paramètres, load
+    // mappe le fichier en mémoire s'il correspond aux paramètres donnés
+    // (sinon rien n'est modifié et load renvoie false).
+    bool save(const char *path) const;
+    bool load(const char *path, uint32_t w, uint32_t h, double zoom, double persistence, int octaves);
+    // réutilise l'index buffer de src, qui doit avoir les mêmes dimensions
+    inline void shareIndices(NoiseTerrain *src) { m_indexSource = src ? src : this; }
+
+    // Hauteur et normale interpolées (bilinéaire) au point (x,y) du monde,
+    // les points en dehors de la tuile prennent la valeur du bord
     float getZ(float x, float y);
+    glm::vec3 getNormal(float x, float y);
+    // Même chose pour count points à la fois, répartis sur plusieurs threads.
+    // normals peut être NULL si on ne veut que les hauteurs.
+    void getZ(const float *x, const float *y, float *z, glm::vec3 *normals, uint32_t count);
 
-    void draw(int pass) {
-        glPushMatrix();
-        //glScalef(50.0, 50.0, 1.0);
-        //glTranslatef(-0.5, -.5, 0.f);
-        float w = TERRAIN_WIDTH;
-        float h = TERRAIN_HEIGHT;
-        glColor3f(1, 1, 1);
-        float reps = TERRAIN_WIDTH/10.f;
-        if (pass == PASS_NORMAL)
-            TextureManager::bindTexture("sand1");
-        for (uint32_t y = 0; y < m_h-1; y++) {
-            glBegin(GL_TRIANGLE_STRIP);
-            for (uint32_t x = 0; x < m_w; x++) {
-                double col = m_hmap[x+y*m_w];
-                glNormal3f(m_normals[x+y*m_w].x, m_normals[x+y*m_w].y, m_normals[x+y*m_w].z);
-                glTexCoord2f(x/((float)m_w)*reps,
-                             y/((float)m_h)*reps);
-                //glColor3f(col, col, col);
-                glVertex3f(((double)(x)/m_w-0.5)*w, ((double)(y)/m_h-0.5)*h, col);
-                y++;
-                col = m_hmap[x+y*m_w];
-                glNormal3f(m_normals[x+y*m_w].x, m_normals[x+y*m_w].y, m_normals[x+y*m_w].z);
-                glTexCoord2f(x/((float)m_w)*reps,
-                             y/((float)m_h)*reps);
-                //glColor3f(col, col, col);
-                glVertex3f(((double)(x)/m_w-0.5)*w, ((double)(y)/m_h-0.5)*h, col);
-                y--;
-            }
-            glEnd();
-        }
-
-        //if (pass == PASS_NORMAL){
-            //glDisable(GL_LIGHTING);
-            //glBegin(GL_LINES);
-            //glColor3f(1, 0, 0);
-            //float s = 0.3f;
-            //for (uint32_t y = 0; y < m_h; y++) {
-                //for (uint32_t x = 0; x < m_w; x++) {
-                    //glVertex3f(w*((double)(x)/m_w-0.5), h*((double)(y)/m_h-0.5), m_hmap[x+y*m_w]);
-                    //glVertex3f(w*((double)(x)/m_w-0.5)+m_normals[x+y*m_w].x*s, h*((double)(y)/m_h-0.5)+m_normals[x+y*m_w].y*s, m_hmap[x+y*m_w]+m_normals[x+y*m_w].z*s);
-                //}
-            //} 
-            //glEnd();
-            //glEnable(GL_LIGHTING);
-            //glColor3f(1,1,1);
-        //}
-
-        glPopMatrix();
-    }
+    void draw(int pass);
+    inline virtual void init(Viewer& v) { m_viewer = &v; }
+
+    // nombre de triangles envoyés lors du dernier draw(PASS_NORMAL)
+    inline uint32_t getNbTriangles() const { return m_nbTriangles; }
 
-    void computeNormals();
     void drawHMap();
 
-    double* getHMap(); 
+    inline uint32_t getNbLayers() const { return m_layers.size(); }
+
+    double* getHMap(); // NULL en dehors de generateClouds
 };
 
 #endif
@@ -1,125 +1,139 @@
 #include "animation.hpp"
-#include "torse.hpp"
 #include <algorithm>
 #include <iostream>
+#include <cmath>
 
-void Animation::generateInterpolation(Torse &me)
+static bool keyAfter(float time, const AnimationKey &k)
 {
-    m_frames.clear();
-    m_frames.resize(m_original.size());
-    for(uint32_t i = 0; i < m_original.size(); ++i) {
-        for (std::list<AnimationFrame>::iterator it(m_original[i].begin()); it != m_original[i].end(); ++it) {
-            //std::cout<<"[1]List at index "<<i<<" is not empty\n";
-            bool found = false;
-            for (uint32_t k = i+1; k < m_original.size(); ++k) {
-                std::list<AnimationFrame>::iterator next(find(m_original[k].begin(), m_original[k].end(), *it));
-                if (next != m_original[k].end()) { // on peut interpoler
-                    uint32_t n = k-i;
-                    AnimationFrame f1(*it),
-                          f2(*next);
-                    // if any value is neg copy current value from me
-                    for (int j = 0; j < 3; j++) {
-                        if (f1.rot[j] <= -360.f)
-                            f1.rot[j] = me.getCurrentRotation(f1.type)[j];
-                        // avoir -1 dans les deux c'est stupide...
-                        if (f2.rot[j] <= -360.f)
-                            f2.rot[j] = me.getCurrentRotation(f2.type)[j];
-                    }
-                    // add the interpolations
-                    //std::cout<<"("<<f1.rot[0]<<","<<f1.rot[1]<<","<<f1.rot[2]<<")\n";
-                    //std::cout<<"[2]Interpolated a frame of type "<<f1.type<<" for frame "<<i<<"\n";
-                    for (uint32_t j = i+1; j < k; j++) {
-                        m_frames[j].push_back(AnimationFrame(f1, f2, j-i, n));
-                        //std::cout<<"[2]Interpolated a frame of type "<<f1.type<<" for frame "<<j<<"\n";
-                    }
-                    //std::cout<<"("<<f2.rot[0]<<","<<f2.rot[1]<<","<<f2.rot[2]<<")\n";
-                    //std::cout<<"[2]Interpolated a frame of type "<<f1.type<<" for frame "<<k<<"\n";
-                    // we add first and last
-                    m_frames[i].push_back(f1);
-                    m_frames[k].push_back(f2);
-                    found = true;
-                    break; // exit this for
-                }
+    return time < k.time;
+}
+
+void Animation::addFrame(float time, frame_type type, const glm::vec3& angles)
+{
+    AnimationKey k;
+    k.time = time;
+    k.rot = angles;
+    std::vector<AnimationKey> &c = m_channels[type];
+    c.insert(std::upper_bound(c.begin(), c.end(), time, keyAfter), k);
+}
+
+void Animation::clear()
+{
+    for (int i = 0; i < e_frame_type_count; i++)
+        m_channels[i].clear();
+}
+
+void Animation::sample(float time, const glm::vec3 *from, glm::vec3 *pose) const
+{
+    for (int i = 0; i < e_frame_type_count; i++) {
+        const std::vector<AnimationKey> &c = m_channels[i];
+        std::vector<AnimationKey>::const_iterator next(std::upper_bound(c.begin(), c.end(), time, keyAfter));
+        if (next == c.begin())
+            continue; // pas encore de clé pour cette partie
+
+        const AnimationKey &a = *(next-1);
+        glm::vec3 rot(a.rot);
+        if (next != c.end()) {
+            const AnimationKey &b = *next;
+            float t = (time-a.time)/(b.time-a.time);
+            for (int j = 0; j < 3; j++) {
+                float ra = a.rot[j] <= -360.f ? from[i][j] : a.rot[j],
+                      rb = b.rot[j] <= -360.f ? from[i][j] : b.rot[j];
+                rot[j] = ra + (rb-ra)*t;
             }
-            if (!found) {// we still can add the first one 
-                for (int j = 0; j < 3; j++) {
-                    if (it->rot[j] <= -360.f)
-                        it->rot[j] = me.getCurrentRotation(it->type)[j];
-                }
-                m_frames[i].push_back(*it);
+        } else {
+            for (int j = 0; j < 3; j++) {
+                if (rot[j] <= -360.f)
+                    rot[j] = from[i][j];
             }
         }
+        pose[i] = rot;
     }
 }
 
-AnimationFrame::AnimationFrame(const AnimationFrame &a, const AnimationFrame &b, uint32_t i, uint32_t n) :
-    rot(a.rot[0] +(b.rot[0]-a.rot[0])*((double)i/n),
-        a.rot[1] +(b.rot[1]-a.rot[1])*((double)i/n),
-        a.rot[2] +(b.rot[2]-a.rot[2])*((double)i/n)
-       ),
-    type(a.type)
-{}
+void Animation::addFrameFromCurrent(float index)
+{
+    addFrame(index, AnimationFrame(e_torse));
+    addFrame(index, AnimationFrame(e_head));
+    addFrame(index, AnimationFrame(e_armUL));
+    addFrame(index, AnimationFrame(e_armUR));
+    addFrame(index, AnimationFrame(e_armLL));
+    addFrame(index, AnimationFrame(e_armLR));
+    addFrame(index, AnimationFrame(e_legUL));
+    addFrame(index, AnimationFrame(e_legLL));
+    addFrame(index, AnimationFrame(e_legUR));
+    addFrame(index, AnimationFrame(e_legLR));
 
-void AnimationFrame::correct()
+}
+
+void AnimationState::play(const Animation *a, const glm::vec3 *pose)
 {
-    for (uint32_t i = 0; i < 3; i++) {
-        if(rot[i] > -360.f && rot[i] < 0.f)
-            rot[i] += 360.f;
-    }
+    clip = a;
+    time = 0.f;
+    for (int i = 0; i < e_frame_type_count; i++)
+        from[i] = pose[i];
 }
 
-void Animation::update(Torse &me, uint32_t frame)
+void AnimationTrack::play(float tick, const Animation *clip, float time)
 {
-    assert(frame < m_frames.size());
-    for (std::list<AnimationFrame>::iterator it(m_frames[frame].begin()); it != m_frames[frame].end(); ++it) {
-        switch (it->type) {
-            case e_armUL:
-                me.m_angULArm = it->rot;
-                break;
-            case e_armLL:
-                me.m_angLLArm = it->rot;
-                break;
-            case e_armUR:
-                me.m_angURArm = it->rot;
-                break;
-            case e_armLR:
-                me.m_angLRArm = it->rot;
-                break;
-            case e_legUL:
-                me.m_angULLeg = it->rot;
-                break;
-            case e_legLL:
-                me.m_angLLLeg = it->rot;
-                break;
-            case e_legUR:
-                me.m_angURLeg = it->rot;
-                break;
-            case e_legLR:
-                me.m_angLRLeg = it->rot;
-                break;
-            case e_head:
-                me.m_angHead = it->rot;
-                break;
-            case e_torse:
-                me.m_angTorse = it->rot;
-                break;
-            default:
-                break;
-        }
-    }
+    glm::vec3 current[e_frame_type_count];
+    pose(tick, current);
+    key_t k;
+    k.state.play(clip, current);
+    k.state.time = time;
+    k.rate = 1.f;
+    m_keys.add(tick, k);
 }
 
-void Animation::addFrameFromCurrent(int index)
+void AnimationTrack::pause(float tick)
 {
-    m_original[index].push_back(AnimationFrame(e_torse));
-    m_original[index].push_back(AnimationFrame(e_head));
-    m_original[index].push_back(AnimationFrame(e_armUL));
-    m_original[index].push_back(AnimationFrame(e_armUR));
-    m_original[index].push_back(AnimationFrame(e_armLL));
-    m_original[index].push_back(AnimationFrame(e_armLR));
-    m_original[index].push_back(AnimationFrame(e_legUL));
-    m_original[index].push_back(AnimationFrame(e_legLL));
-    m_original[index].push_back(AnimationFrame(e_legUR));
-    m_original[index].push_back(AnimationFrame(e_legLR));
+    key_t k;
+    if (!state(tick-1, k.state))
+        return;
+    k.rate = 0.f;
+    m_keys.add(tick, k);
+}
 
+void AnimationTrack::resume(float tick)
+{
+    key_t k;
+    if (!state(tick-1, k.state))
+        return;
+    k.state.time += 1.f;
+    k.rate = 1.f;
+    m_keys.add(tick, k);
+}
+
+float AnimationTrack::end() const
+{
+    if (m_keys.empty() || m_keys.back().rate == 0.f)
+        return TIMELINE_END;
+    const key_t &k = m_keys.back();
+    // le temps de l'animation reboucle à chaque période
+    float period = k.state.clip->getDuration()+1.f,
+          t = k.state.time - period*floor(k.state.time/period);
+    return m_keys.getTime(m_keys.size()-1) + (period-t)/k.rate;
+}
+
+bool AnimationTrack::state(float tick, AnimationState &s) const
+{
+    int i = m_keys.find(tick);
+    if (i < 0)
+        return false;
+    const key_t &k = m_keys.getValue(i);
+    s = k.state;
+    float period = s.clip->getDuration()+1.f;
+    s.time += k.rate*(tick - m_keys.getTime(i));
+    s.time -= period*floor(s.time/period);
+    return true;
+}
+
+void AnimationTrack::pose(float tick, glm::vec3 *pose) const
+{
+    AnimationState s;
+    if (!state(tick, s))
+        return;
+    for (int i = 0; i < e_frame_type_count; i++)
+        pose[i] = s.from[i];
+    s.sample(pose);
 }
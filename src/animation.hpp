@@ -9,14 +9,13 @@
  ******************************************************************************/
 
 #include <vector>
-#include <list>
+#include <cstddef>
 #include <stdint.h>
 #include "glm/vec3.hpp"
 #include "globals.hpp"
+#include "timeline.hpp"
 #define CURRENT_VALUE (-361.f)
 
-class Torse;
-
 // rotations dans une frame donnée
 class AnimationFrame {
     public:
@@ -25,11 +24,12 @@ class AnimationFrame {
     AnimationFrame(const glm::vec3 v, frame_type t) : rot(v), type(t) {}
     AnimationFrame(frame_type t) : rot(CURRENT_VALUE, CURRENT_VALUE, CURRENT_VALUE), type(t) {} // prends les valeurs antérieures
     AnimationFrame(const AnimationFrame &o) : rot(o.rot), type(o.type) {}
-    AnimationFrame(const AnimationFrame &a, const AnimationFrame &b, uint32_t i, uint32_t n); // interpolates
-    inline bool operator==(const AnimationFrame& b) { return type == b.type; }
-    inline bool operator!=(const AnimationFrame& b) { return type != b.type; }
-    private:
-    void correct(); // pas d'angles négatifs
+};
+
+// clé d'un canal: rotation d'une partie du corps à un instant donné
+struct AnimationKey {
+    float time;
+    glm::vec3 rot;
 };
 
 // on ajoute des frames qui indiquent le changement des rotations d'une des
@@ -38,21 +38,70 @@ class AnimationFrame {
 // qui sont utilisées. Il faut obligatoirement avoir un élément dans la frame 0
 // On peut utiliser plusieurs animations si certaines actions ont une durée
 // différente
+// Chaque partie du corps a son canal de clés triées par temps. On
+// l'échantillonne à n'importe quel instant (pas forcément entier) par
+// recherche dichotomique, il n'y a donc rien à précalculer quand on change
+// d'animation. Avant sa première clé une partie du corps n'est pas modifiée,
+// après la dernière elle garde la valeur de celle-ci.
 class Animation {
-    std::vector<std::list<AnimationFrame> > m_frames, m_original;
+    std::vector<AnimationKey> m_channels[e_frame_type_count];
+    float m_duration; // instant de la dernière frame
 
     public:
-    Animation(int nbAnimationFrames) : m_frames(), m_original(nbAnimationFrames) {}
-    ~Animation() {m_frames.clear(); m_original.clear();}
-
-    void generateInterpolation(Torse& me);
-    void update(Torse &me, uint32_t frame);
-    inline uint32_t getSize() const { return m_frames.size(); }
-    inline void clear() { m_original.clear(); }
-    inline void addFrame(int index, AnimationFrame& f) { m_original[index].push_back(f); }
-    inline void addFrame(int index, frame_type type, const glm::vec3& angles) { m_original[index].push_back(AnimationFrame(angles, type));}
-    inline void addFrame(int index, frame_type type) { m_original[index].push_back(AnimationFrame(type));}
-    void addFrameFromCurrent(int index);
+    Animation(int nbAnimationFrames) : m_duration(nbAnimationFrames-1) {}
+
+    // rotations à l'instant time dans pose (e_frame_type_count éléments),
+    // from donne les valeurs courantes au début de l'animation
+    void sample(float time, const glm::vec3 *from, glm::vec3 *pose) const;
+    inline float getDuration() const { return m_duration; }
+    // instant suivant, on boucle après la dernière frame
+    inline float next(float time, float dt = 1.f) const { return time >= m_duration ? 0.f : time+dt; }
+    void clear();
+    void addFrame(float time, frame_type type, const glm::vec3& angles);
+    inline void addFrame(float time, const AnimationFrame& f) { addFrame(time, f.type, f.rot); }
+    inline void addFrame(float time, frame_type type) { addFrame(time, type, glm::vec3(CURRENT_VALUE)); }
+    void addFrameFromCurrent(float time);
+};
+
+// Une Animation ne change plus une fois construite et peut être partagée par
+// autant d'instances que l'on veut, chacune garde son propre état de lecture.
+struct AnimationState {
+    const Animation *clip;
+    float time;
+    glm::vec3 from[e_frame_type_count]; // pose au moment du changement d'animation
+
+    AnimationState() : clip(NULL), time(0.f) {}
+    // commence clip depuis la pose actuelle
+    void play(const Animation *a, const glm::vec3 *pose);
+    inline void sample(glm::vec3 *pose) const { clip->sample(time, from, pose); }
+    inline void advance(float dt = 1.f) { time = clip->next(time, dt); }
+};
+
+// Enchaînement d'animations au cours de l'histoire, en ticks. Chaque clé
+// est un AnimationState figé à son tick avec une vitesse (0 en pause):
+// l'état à n'importe quel tick se lit sur la dernière clé, sans rejouer les
+// ticks précédents. Les clés sont ajoutées dans l'ordre.
+class AnimationTrack {
+    struct key_t {
+        AnimationState state;
+        float rate;
+    };
+    StepTrack<key_t> m_keys;
+
+public:
+    // clip commence à tick, depuis la pose qu'on a à ce moment, et en est à
+    // l'instant time au tick donné
+    void play(float tick, const Animation *clip, float time = 0.f);
+    // le tick donné n'avance plus l'animation, jusqu'au prochain resume
+    void pause(float tick);
+    void resume(float tick);
+    // tick où la dernière animation revient au début
+    float end() const;
+
+    // état au tick, false avant la première clé
+    bool state(float tick, AnimationState &s) const;
+    // rotations au tick, pose n'est pas modifié avant la première clé
+    void pose(float tick, glm::vec3 *pose) const;
 };
 
 #endif
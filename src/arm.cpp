@@ -2,6 +2,7 @@
 using namespace std;
 #include "arm.hpp"
 #include "cylinder.hpp"
+#include "mesh.hpp"
 #include <cmath>
 
 
@@ -14,14 +15,19 @@ Arm::Arm(int prec) :
 }
 
 void Arm::draw(int pass)
+{
+    draw(pass, 0);
+}
+
+void Arm::draw(int pass, int level)
 {
     glPushMatrix();
-    glutSolidSphere(0.5, m_precision, m_precision);
+    Mesh::sphere(0.5, m_precision, m_precision, level).draw();
     //glPushMatrix();
     //glTranslatef(m_length/2.0, 0,0);
     glRotatef(90, 0, 1, 0);
     //glRotatef(20, 1, 0, 0);
-    m_figure.draw(pass);
+    m_figure.draw(pass, level);
     //glPopMatrix();
     //glTranslatef( 0, -m_length*sin(90), 0);
     //glutSolidSphere(0.5, m_precision, m_precision);
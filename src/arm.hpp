@@ -13,6 +13,7 @@ class Arm : public Renderable
 {
     public:
         void draw(int pass);
+        void draw(int pass, int level);
         Arm(int prec);
         inline float getWidth() const { return m_width; }
         inline float getLength() const { return m_length; }
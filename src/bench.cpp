@@ -0,0 +1,345 @@
+#include "bench.hpp"
+#include "crowd.hpp"
+#include "springSystem.hpp"
+#include "pbdSystem.hpp"
+#include "particlesystem.hpp"
+#include "particle.hpp"
+#include "spring.hpp"
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QThread>
+#include <iostream>
+#include <cstdlib>
+#include <map>
+#include <algorithm>
+
+typedef void (*bench_fn)();
+
+struct bench_t {
+    const char *name;
+    bench_fn fn;
+};
+
+// temps moyen d'un appel de update en ms
+static double timeCrowd(Crowd &crowd, uint32_t grain, int ticks)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < ticks; i++)
+        crowd.update(grain);
+    return timer.nsecsElapsed()/1e6/ticks;
+}
+
+static void benchCrowd()
+{
+    const int ticks = 300;
+    std::cout<<"threads: "<<QThreadPool::globalInstance()->maxThreadCount()+1<<"\n";
+    for (uint32_t n = 1000; n <= 8000; n *= 2) {
+        srand(0);
+        Crowd crowd(n, glm::vec3());
+        double single = timeCrowd(crowd, n, ticks),
+               multi = timeCrowd(crowd, CROWD_GRAIN, ticks);
+        std::cout<<n<<" divers: "<<single<<" ms/tick on one thread, "
+            <<multi<<" ms/tick on the pool ("<<single/multi<<"x), "
+            <<n/multi*1e-3<<" M poses/s\n";
+    }
+}
+
+// Ancien pas de DynamicSystem::animate (sans collisions): une particule
+// allouée par objet et les forces accumulées dans une map
+static void legacyStep(std::vector<Particle*> &particles, std::vector<Spring*> &springs,
+        const Vec &gravity, double viscosity, double dt)
+{
+    std::map<const Particle*, Vec> forces;
+    for (uint32_t i = 0; i < particles.size(); i++) {
+        Particle *p = particles[i];
+        forces[p] = gravity * p->getMass();
+        forces[p] += -viscosity * p->getVelocity();
+    }
+    for (uint32_t i = 0; i < springs.size(); i++) {
+        Vec f12 = springs[i]->getCurrentForce();
+        forces[springs[i]->getParticle1()] += f12;
+        forces[springs[i]->getParticle2()] -= f12;
+    }
+    for (uint32_t i = 0; i < particles.size(); i++)
+        particles[i]->incrVelocity(dt * (forces[particles[i]] * particles[i]->getInvMass()));
+    for (uint32_t i = 0; i < particles.size(); i++)
+        particles[i]->incrPosition(dt * particles[i]->getVelocity());
+}
+
+#define CLOTH_SIDE 100
+#define CLOTH_STEPS 100
+
+// Tissu de CLOTH_SIDE² particules (bord du haut fixe) relié par des
+// ressorts horizontaux et verticaux, avec les paramètres de
+// DynamicSystem::init, sans collisions
+template <class Real, class Vec3>
+static double timeCloth(SpringSystem<Real, Vec3> &system)
+{
+    system.setCollisions(false);
+    for (uint32_t i = 0; i < CLOTH_SIDE; i++) {
+        for (uint32_t j = 0; j < CLOTH_SIDE; j++)
+            system.addParticle(Vec3(Real(j), Real(0), -Real(i)), Vec3(), i == 0 ? Real(0) : Real(1), Real(0.25));
+    }
+    for (uint32_t i = 0; i < CLOTH_SIDE; i++) {
+        for (uint32_t j = 0; j < CLOTH_SIDE; j++) {
+            uint32_t k = i*CLOTH_SIDE + j;
+            if (j+1 < CLOTH_SIDE)
+                system.addSpring(k, k+1, Real(30), Real(1), Real(1));
+            if (i+1 < CLOTH_SIDE)
+                system.addSpring(k, k+CLOTH_SIDE, Real(30), Real(1), Real(1));
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int s = 0; s < CLOTH_STEPS; s++)
+        system.step();
+    return timer.nsecsElapsed()/1e6/CLOTH_STEPS;
+}
+
+// Le même tissu avec l'ancienne boucle, en double, contre le cœur en
+// double puis en float
+static void benchDynamics()
+{
+    const uint32_t side = CLOTH_SIDE;
+    std::vector<Particle*> particles;
+    std::vector<Spring*> springs;
+    for (uint32_t i = 0; i < side; i++) {
+        for (uint32_t j = 0; j < side; j++)
+            particles.push_back(new Particle(Vec(j, 0.0, -(double)i), Vec(), i == 0 ? 0.0 : 1.0, 0.25));
+    }
+    for (uint32_t i = 0; i < side; i++) {
+        for (uint32_t j = 0; j < side; j++) {
+            uint32_t k = i*side + j;
+            if (j+1 < side)
+                springs.push_back(new Spring(particles[k], particles[k+1], 30.0, 1.0, 1.0));
+            if (i+1 < side)
+                springs.push_back(new Spring(particles[k], particles[k+side], 30.0, 1.0, 1.0));
+        }
+    }
+    QElapsedTimer timer;
+    timer.start();
+    for (int s = 0; s < CLOTH_STEPS; s++)
+        legacyStep(particles, springs, Vec(0.0, 0.0, -10.0), 1.0, 0.1);
+    double legacy = timer.nsecsElapsed()/1e6/CLOTH_STEPS;
+
+    SpringSystem<double, glm::dvec3> dsystem;
+    SpringSystem<float, glm::vec3> fsystem;
+    double dms = timeCloth(dsystem), fms = timeCloth(fsystem);
+
+    double derr = 0.0, ferr = 0.0;
+    for (uint32_t i = 0; i < particles.size(); i++) {
+        const Vec &p = particles[i]->getPosition();
+        glm::dvec3 ref(p.x, p.y, p.z);
+        derr = std::max(derr, glm::length(dsystem.getPosition(i) - ref));
+        ferr = std::max(ferr, glm::length(glm::dvec3(fsystem.getPosition(i)) - ref));
+        delete particles[i];
+    }
+    for (uint32_t i = 0; i < springs.size(); i++)
+        delete springs[i];
+
+    std::cout<<dsystem.getNbParticles()<<" particles, "<<dsystem.getNbSprings()<<" springs, "
+        <<CLOTH_STEPS<<" steps\n"
+        <<"pointers + map: "<<legacy<<" ms/step\n"
+        <<"arrays, double: "<<dms<<" ms/step ("<<legacy/dms<<"x), max difference "<<derr<<"\n"
+        <<"arrays, float: "<<fms<<" ms/step ("<<legacy/fms<<"x), max difference "<<ferr<<"\n";
+
+    // tas dense de particules libres, collisions activées
+    srand(0);
+    fsystem.clear();
+    fsystem.setCollisions(true);
+    for (uint32_t i = 0; i < side*side; i++) {
+        glm::vec3 pos(rand()%1000/10.f, rand()%1000/10.f, rand()%100/10.f);
+        fsystem.addParticle(pos, glm::vec3(), 1.f, 0.25f);
+    }
+    timer.start();
+    for (int s = 0; s < CLOTH_STEPS; s++)
+        fsystem.step();
+    std::cout<<fsystem.getNbParticles()<<" particles with collisions: "
+        <<timer.nsecsElapsed()/1e6/CLOTH_STEPS<<" ms/step\n";
+}
+
+// Corde horizontale de n particules (la première fixe), lâchée sous la
+// gravité pendant duration secondes simulées avec des pas de dt. Renvoie le
+// temps de calcul en ms, ou -1 si la corde a explosé.
+static double simulateRope(SpringSystem<float, glm::vec3>::integrator_t integrator, uint32_t n,
+        float stiffness, float dt, float duration)
+{
+    SpringSystem<float, glm::vec3> rope;
+    rope.setCollisions(false);
+    rope.setIntegrator(integrator);
+    rope.setTimeStep(dt);
+    for (uint32_t i = 0; i < n; i++) {
+        rope.addParticle(glm::vec3(i, 0.f, 0.f), glm::vec3(), i == 0 ? 0.f : 1.f, 0.25f);
+        if (i > 0)
+            rope.addSpring(i-1, i, stiffness, 1.f, 1.f);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int steps = (int)(duration/dt + 0.5f);
+    for (int s = 0; s < steps; s++)
+        rope.step();
+    double ms = timer.nsecsElapsed()/1e6;
+
+    // stable si aucun ressort n'a doublé de longueur
+    for (uint32_t i = 1; i < n; i++) {
+        float l = glm::length(rope.getPosition(i) - rope.getPosition(i-1));
+        if (!(l < 2.f))
+            return -1.0;
+    }
+    return ms;
+}
+
+// Coût d'une seconde simulée pour des cordes raides: implicite au pas de
+// l'image contre explicite avec assez de sous-pas pour rester stable
+static void benchStiff()
+{
+    const uint32_t n = 1000;
+    typedef SpringSystem<float, glm::vec3> Rope;
+    const float frame = 0.1f, duration = 1.f;
+    std::cout<<n<<" particle rope, time step "<<frame<<", cost per simulated second\n";
+    for (float k = 30.f; k <= 300000.f; k *= 10.f) {
+        double implicit = simulateRope(Rope::e_implicit, n, k, frame, duration);
+        int substeps = 1;
+        double explicitMs = -1.0;
+        for (; substeps <= 1024 && explicitMs < 0.0; substeps *= 2)
+            explicitMs = simulateRope(Rope::e_explicit, n, k, frame/substeps, duration);
+        std::cout<<"stiffness "<<k<<": implicit ";
+        if (implicit < 0.0)
+            std::cout<<"unstable";
+        else
+            std::cout<<implicit<<" ms";
+        std::cout<<", explicit ";
+        if (explicitMs < 0.0)
+            std::cout<<"unstable";
+        else
+            std::cout<<explicitMs<<" ms with "<<substeps/2<<" substeps";
+        std::cout<<"\n";
+    }
+}
+
+// allongement relatif moyen des contraintes de structure (les premières
+// de chaque paire de particules voisines)
+static double meanStretch(const PBDSystem &sys, uint32_t first, uint32_t n)
+{
+    double sum = 0.0;
+    for (uint32_t i = first; i+1 < first+n; i++)
+        sum += glm::length(sys.getPosition(i+1) - sys.getPosition(i));
+    return sum/(n-1) - 1.0;
+}
+
+// Passage à l'échelle du solveur PBD sur un grand tissu, puis effet du
+// nombre d'itérations sur une corde pour une raideur donnée
+static void benchPBD()
+{
+    const uint32_t side = 256;
+    const int steps = 30;
+    QThreadPool *pool = QThreadPool::globalInstance();
+    const int maxThreads = pool->maxThreadCount();
+
+    PBDSystem cloth;
+    cloth.addCloth(glm::vec3(), glm::vec3(side-1, 0.f, 0.f), glm::vec3(0.f, 0.f, -(float)(side-1)),
+            side, side, 1.f, 0.1f);
+    cloth.setAcceleration(glm::vec3(0.f, 0.f, -10.f));
+    std::cout<<cloth.getNbParticles()<<" particles, "<<cloth.getNbConstraints()
+        <<" constraints, "<<cloth.getNbColors()<<" colors, "<<PBD_ITERATIONS<<" iterations\n";
+    double single = 0.0;
+    for (int t = 1; t <= QThread::idealThreadCount(); t *= 2) {
+        // parallelFor utilise les threads du pool plus l'appelant
+        pool->setMaxThreadCount(t-1);
+        QElapsedTimer timer;
+        timer.start();
+        for (int s = 0; s < steps; s++)
+            cloth.update();
+        double ms = timer.nsecsElapsed()/1e6/steps;
+        if (t == 1)
+            single = ms;
+        std::cout<<t<<" threads: "<<ms<<" ms/step ("<<single/ms<<"x)\n";
+    }
+    pool->setMaxThreadCount(maxThreads);
+
+    // corde de 50 particules pendue pendant 20 s, jusqu'à l'équilibre
+    const uint32_t n = 50;
+    const float stiffness[] = { 1.f, 0.99f, 0.9f, 0.5f };
+    std::cout<<"rope stretch at rest:\n";
+    for (int i = 0; i < 4; i++) {
+        float k = stiffness[i];
+        std::cout<<"stiffness "<<k<<":";
+        for (uint32_t it = 1; it <= 16; it *= 2) {
+            PBDSystem rope;
+            rope.addRope(glm::vec3(), glm::vec3(0.f, 0.f, -(float)(n-1)), n, k, 0.f);
+            rope.setAcceleration(glm::vec3(0.f, 0.f, -10.f));
+            rope.setIterations(it);
+            for (int s = 0; s < 600; s++)
+                rope.update();
+            std::cout<<" "<<it<<" it "<<meanStretch(rope, 0, n)*100.0<<"%";
+        }
+        std::cout<<"\n";
+    }
+}
+
+// temps moyen d'un animate en ms
+static double timeParticles(ParticleSystem &ps, int frames)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < frames; i++)
+        ps.animate();
+    return timer.nsecsElapsed()/1e6/frames;
+}
+
+// Émission continue jusqu'à remplir 100k particules, puis intégration en
+// SSE et en scalaire
+static void benchParticles()
+{
+    const uint32_t capacity = 100000;
+    ParticleSystem ps(capacity);
+    // 40k/s vivant 2 à 4 s: le pool reste plein
+    ps.addEmitter(ParticleSystem::Emitter(glm::vec3(), glm::vec3(0.f, 0.f, 1.f),
+                30.f, 40000.f, 1.f, 3.f, 2.f, 4.f));
+    srand(0);
+    timeParticles(ps, 150);
+    std::cout<<ps.getCount()<<"/"<<ps.getCapacity()<<" particles alive\n";
+    double simd = -1.0;
+    if (ps.hasSIMD())
+        simd = timeParticles(ps, 300);
+    ps.setSIMD(false);
+    double scalar = timeParticles(ps, 300);
+    std::cout<<"scalar: "<<scalar<<" ms/frame\n";
+    if (simd < 0.0)
+        std::cout<<"SSE: not available\n";
+    else
+        std::cout<<"SSE: "<<simd<<" ms/frame ("<<scalar/simd<<"x)\n";
+}
+
+static const bench_t s_benchs[] = {
+    { "crowd", benchCrowd },
+    { "dynamics", benchDynamics },
+    { "stiff", benchStiff },
+    { "pbd", benchPBD },
+    { "particles", benchParticles },
+};
+static const int s_nbBenchs = sizeof(s_benchs)/sizeof(s_benchs[0]);
+
+int Bench::run(const std::string &name)
+{
+    for (int i = 0; i < s_nbBenchs; i++) {
+        if (name == s_benchs[i].name) {
+            s_benchs[i].fn();
+            return 0;
+        }
+    }
+    std::cerr<<"Unknown bench '"<<name<<"'\n";
+    list();
+    return 1;
+}
+
+void Bench::list()
+{
+    std::cerr<<"Available benchs:";
+    for (int i = 0; i < s_nbBenchs; i++)
+        std::cerr<<" "<<s_benchs[i].name;
+    std::cerr<<"\n";
+}
@@ -0,0 +1,24 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+/*******************************************************************************
+ *  Bench                                                                      *
+ *  Thu Jun 05 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include <string>
+
+// Mesures de performance lancées par `cg3D --bench <nom>`, avant la création
+// de la fenêtre: rien ne doit y utiliser OpenGL. Les résultats sont écrits
+// sur la sortie standard.
+class Bench {
+public:
+    // lance le bench name, renvoie le code de sortie du programme
+    static int run(const std::string &name);
+    // affiche les benchs disponibles
+    static void list();
+};
+
+#endif
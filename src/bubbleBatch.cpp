@@ -0,0 +1,183 @@
+#include "bubbleBatch.hpp"
+#include "renderQueue.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+BubbleBatch::BubbleBatch() : m_texture(0)
+{
+}
+
+BubbleBatch::~BubbleBatch()
+{
+    if (m_texture)
+        glDeleteTextures(1, &m_texture);
+}
+
+void BubbleBatch::add(float radius, const glm::vec3 &pos)
+{
+    m_positions.push_back(pos);
+    m_dx.push_back(0.f);
+    m_dy.push_back(0.f);
+    m_radii.push_back(radius);
+    m_ages.push_back(0);
+}
+
+// remplacée par la dernière
+void BubbleBatch::remove(uint32_t i)
+{
+    m_positions[i] = m_positions.back();
+    m_dx[i] = m_dx.back();
+    m_dy[i] = m_dy.back();
+    m_radii[i] = m_radii.back();
+    m_ages[i] = m_ages.back();
+    m_positions.pop_back();
+    m_dx.pop_back();
+    m_dy.pop_back();
+    m_radii.pop_back();
+    m_ages.pop_back();
+}
+
+void BubbleBatch::animate()
+{
+    uint32_t i = 0;
+    while (i < m_positions.size()) {
+        // loin au dessus de la scène
+        if (++m_ages[i] > BUBBLE_LIFETIME) {
+            remove(i);
+            continue;
+        }
+        m_dx[i] += ((rand()%3)-1)*0.001f;
+        m_dy[i] += ((rand()%3)-1)*0.001f;
+        m_positions[i] += glm::vec3(m_dx[i], m_dy[i], BUBBLE_RISE);
+        i++;
+    }
+}
+
+// Sphère éclairée vue de face: presque transparente au centre, plus
+// opaque sur le bord et avec un reflet en haut à gauche
+void BubbleBatch::createTexture()
+{
+    const int size = BUBBLE_TEXTURE_SIZE;
+    std::vector<GLubyte> texels(size*size*4);
+    const float lx = -0.4f, ly = 0.5f, lz = 0.77f;
+    for (int j = 0; j < size; j++) {
+        for (int i = 0; i < size; i++) {
+            float u = (i + 0.5f)/size*2.f - 1.f, v = (j + 0.5f)/size*2.f - 1.f,
+                  r2 = u*u + v*v;
+            GLubyte *t = &texels[(j*size + i)*4];
+            if (r2 >= 1.f) {
+                t[0] = t[1] = t[2] = 255;
+                t[3] = 0;
+                continue;
+            }
+            float nz = sqrt(1.f - r2),
+                  rim = 1.f - nz,
+                  spec = pow(std::max(0.f, u*lx + v*ly + nz*lz), 40.f),
+                  alpha = std::min(1.f, 0.15f + 0.7f*rim*rim + spec),
+                  lum = std::min(1.f, 0.7f + 0.3f*spec);
+            t[0] = t[1] = t[2] = (GLubyte)(255*lum);
+            t[3] = (GLubyte)(255*alpha);
+        }
+    }
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, &texels[0]);
+}
+
+void BubbleBatch::radixSort()
+{
+    const uint32_t n = m_keys.size();
+    m_tmpKeys.resize(n);
+    m_tmpOrder.resize(n);
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t count[257];
+        memset(count, 0, sizeof(count));
+        for (uint32_t i = 0; i < n; i++)
+            count[((m_keys[i] >> shift) & 0xff) + 1]++;
+        for (int b = 0; b < 256; b++)
+            count[b+1] += count[b];
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t dst = count[(m_keys[i] >> shift) & 0xff]++;
+            m_tmpKeys[dst] = m_keys[i];
+            m_tmpOrder[dst] = m_order[i];
+        }
+        m_keys.swap(m_tmpKeys);
+        m_order.swap(m_tmpOrder);
+    }
+}
+
+void BubbleBatch::submit(RenderQueue &queue, int pass)
+{
+    if (pass == PASS_NORMAL && !m_positions.empty())
+        queue.submit(this, 0, pass, RENDER_TRANSPARENT);
+}
+
+void BubbleBatch::draw(int pass)
+{
+    // les caustiques ne se voient pas sur des bulles transparentes
+    if (pass != PASS_NORMAL || m_positions.empty())
+        return;
+    if (!m_texture)
+        createTexture();
+
+    // z dans le repère de la caméra, négatif devant: les plus petits sont
+    // les plus loin. Les colonnes de la modelview donnent aussi les axes de
+    // la caméra dans le repère courant.
+    GLfloat mv[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, mv);
+    const glm::vec3 right(mv[0], mv[4], mv[8]), up(mv[1], mv[5], mv[9]);
+    const uint32_t n = m_positions.size();
+    m_keys.resize(n);
+    m_order.resize(n);
+    for (uint32_t i = 0; i < n; i++) {
+        const glm::vec3 &p = m_positions[i];
+        float z = mv[2]*p.x + mv[6]*p.y + mv[10]*p.z + mv[14];
+        // flottant vers entier dans le même ordre
+        uint32_t bits;
+        memcpy(&bits, &z, sizeof(bits));
+        m_keys[i] = bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+        m_order[i] = i;
+    }
+    radixSort();
+
+    m_vertices.resize(n*20);
+    static const float corners[4][2] = { {-1.f, -1.f}, {1.f, -1.f}, {1.f, 1.f}, {-1.f, 1.f} };
+    for (uint32_t k = 0; k < n; k++) {
+        uint32_t i = m_order[k];
+        const glm::vec3 &p = m_positions[i];
+        const float r = m_radii[i];
+        for (int c = 0; c < 4; c++) {
+            GLfloat *v = &m_vertices[(k*4 + c)*5];
+            glm::vec3 q(p + right*(corners[c][0]*r) + up*(corners[c][1]*r));
+            v[0] = q.x;
+            v[1] = q.y;
+            v[2] = q.z;
+            v[3] = 0.5f + 0.5f*corners[c][0];
+            v[4] = 0.5f + 0.5f*corners[c][1];
+        }
+    }
+
+    glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+    glDisable(GL_LIGHTING);
+    glEnable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glColor4f(0.75f, 0.85f, 1.f, 0.9f);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 5*sizeof(GLfloat), &m_vertices[0]);
+    glTexCoordPointer(2, GL_FLOAT, 5*sizeof(GLfloat), &m_vertices[3]);
+    glDrawArrays(GL_QUADS, 0, n*4);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glPopAttrib();
+}
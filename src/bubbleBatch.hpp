@@ -0,0 +1,62 @@
+#ifndef __BUBBLE_BATCH_H__
+#define __BUBBLE_BATCH_H__
+/*******************************************************************************
+ *  BubbleBatch                                                                *
+ *  Sat Jun 07 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include "renderable.hpp"
+#include "const.hpp"
+#ifndef __APPLE__
+#include <GL/glut.h>
+#else
+#include <GLUT/glut.h>
+#endif
+#include <vector>
+#include <stdint.h>
+#include "glm/vec3.hpp"
+
+#define BUBBLE_LIFETIME (10*fps) // ticks avant de disparaître
+#define BUBBLE_RISE 0.5f // montée par tick
+#define BUBBLE_TEXTURE_SIZE 64
+
+// Toutes les bulles de la scène. Elles sont dessinées après les objets
+// opaques en un seul glDrawArrays de quads face à la caméra, texturés par
+// une sphère calculée une fois, triés de la plus loin à la plus proche par
+// un tri par base sur la profondeur dans le repère de la caméra. Le
+// blending n'est réglé qu'une fois par image et rien n'est dessiné dans la
+// passe des caustiques.
+class BubbleBatch : public Renderable {
+    std::vector<glm::vec3> m_positions;
+    std::vector<float> m_dx, m_dy; // dérive horizontale
+    std::vector<float> m_radii;
+    std::vector<int> m_ages;
+
+    // tri et sommets, gardés d'une image à l'autre
+    std::vector<uint32_t> m_keys, m_order, m_tmpKeys, m_tmpOrder;
+    std::vector<GLfloat> m_vertices; // x y z s t, 4 par bulle
+    GLuint m_texture;
+
+    void remove(uint32_t i);
+    void createTexture();
+    // m_order trié selon m_keys croissantes, 4 passes de 8 bits
+    void radixSort();
+
+public:
+    BubbleBatch();
+    ~BubbleBatch();
+
+    void add(float radius, const glm::vec3 &pos);
+
+    void animate();
+    void draw(int pass);
+    // après tous les objets opaques
+    void submit(RenderQueue &queue, int pass);
+
+    inline uint32_t getNbBubbles() const { return m_positions.size(); }
+};
+
+#endif
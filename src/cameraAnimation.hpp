@@ -12,6 +12,7 @@
 #include <QGLViewer/qglviewer.h>
 #include <vector>
 #include "glm/vec3.hpp"
+#include "timeline.hpp"
 
 class CameraFrame {
     public:
@@ -20,26 +21,31 @@ class CameraFrame {
         CameraFrame() : pos(), look(), interpolate(false) {}
         CameraFrame(const glm::vec3 &p, const glm::vec3 &l, bool in) : pos(p), look(l), interpolate(in) {}
         CameraFrame(const CameraFrame &a) : pos(a.pos), look(a.look), interpolate(a.interpolate) {}
-        CameraFrame(const CameraFrame &a, const CameraFrame &b, int i, int n);
+        CameraFrame(const CameraFrame &a, const CameraFrame &b, float t);
 };
 
-class CameraAnimation : public Renderable {
+// Trajet de la caméra: des images clés triées par tick. Une clé est posée à
+// son tick puis la caméra est laissée libre, sauf si la clé suivante a
+// interpolate: la caméra va alors de l'une à l'autre. La position à un tick est lue directement, cf Timeline.
+class CameraAnimation : public Renderable, public Timeline::Actor {
     protected:
-        std::vector<CameraFrame*> m_original, m_frames;
-        uint32_t m_ind;
+        StepTrack<CameraFrame> m_keys;
         qglviewer::Camera *m_cam;
         bool *m_active;
 
     public:
-        CameraAnimation(uint32_t nbFrames, qglviewer::Camera &cam, bool &active);
+        CameraAnimation(qglviewer::Camera &cam, bool &active);
         ~CameraAnimation();
-        inline void addFrame(int i, const CameraFrame &frame) { m_original[i] = (new CameraFrame(frame)); }
+        inline void addFrame(int i, const CameraFrame &frame) { m_keys.add(i, frame); }
         inline void addFrame(int i, const glm::vec3 &pos, const glm::vec3 &look, bool interpolate) {
-            m_original[i] = (new CameraFrame(pos, look, interpolate));
+            m_keys.add(i, CameraFrame(pos, look, interpolate));
         }
-        void interpolate();
+        // image de la caméra au tick time, false si elle est libre
+        bool frameAt(float time, CameraFrame &frame) const;
         void draw(int pass) {}
+        void submit(RenderQueue&, int) {}
         void animate();
+        void seek(float time);
 };
 
 #endif
@@ -1,7 +1,7 @@
 #include "chest.hpp"
 #include "objManager.hpp"
 #include "viewer.hpp"
-#include "bubble.hpp"
+#include "bubbleBatch.hpp"
 
 Chest::Chest() : m_model(objManager::getObj("chest")), m_viewer(NULL),
     m_timer(0), m_pos(-28.f, 10.f, 0.3f), m_size(2.f, 1.f, 1.5f)
@@ -22,7 +22,7 @@ void Chest::animate()
     if (m_timer == 0) {
         int  n = rand()%3+1;
         for (int i = 0; i < n; ++i)
-            m_viewer->addRenderable(new Bubble((rand()%40)/65.f, m_pos.x+m_size.x/2.f,
+            m_viewer->bubbles->add((rand()%40)/65.f, glm::vec3(m_pos.x+m_size.x/2.f,
                     m_pos.y-m_size.y/.2f,
                     m_pos.z+m_size.z/2.f));
     }
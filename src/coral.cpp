@@ -3,89 +3,80 @@ using namespace std;
 #include "coral.hpp"
 #include "TextureManager.hpp"
 #include <cstdlib>
+#include <map>
+#include "glm/gtc/matrix_transform.hpp"
 
-Coral::Coral(int depth, int x, int y, float mult, float h) : 
-	m_coral(depth/mult,depth/mult*0.3,5)
+// arbres partagés, par profondeur
+static std::map<int, std::vector<Mesh*> > s_templates;
+
+// Même arbre que l'ancien Coral récursif: chaque branche est un cylindre
+// de hauteur depth/mult, décalé vers le haut de sa propre hauteur, pivoté
+// pour se détacher du parent puis autour de z pour ne pas aligner toutes
+// les branches dans le même plan.
+static void addBranch(Mesh &mesh, glm::mat4 m, int depth, float mult, int angle, bool root)
+{
+    float height = depth/mult;
+    if (!root) {
+        m = glm::translate(m, glm::vec3(0.f, 0.f, height - depth/10.0/1.7));
+        m = glm::rotate(m, (float)angle, glm::vec3(1.f, 0.f, 0.f));
+        m = glm::rotate(m, (float)angle*2.f, glm::vec3(0.f, 0.f, 1.f));
+    }
+    mesh.addCylinder(m, height, height*0.3f, 5);
+
+    if (depth > 0) {
+        for (int i = 0; i < 2; i++) {
+            addBranch(mesh, m, depth-1, Coral::randomBetween(Coral::minMult, Coral::maxMult),
+                    i%2 == 0 ? -Coral::defaultAngle : Coral::defaultAngle, false);
+        }
+    }
+}
+
+Mesh& Coral::getTemplate(int depth, int variant)
+{
+    std::vector<Mesh*> &variants = s_templates[depth];
+    if (variants.empty()) {
+        for (int i = 0; i < CORAL_VARIANTS; i++) {
+            Mesh *mesh = new Mesh();
+            addBranch(*mesh, glm::mat4(1.f), depth, CORAL_REF_MULT, 0, true);
+            variants.push_back(mesh);
+        }
+    }
+    return *variants[variant];
+}
+
+Coral::Coral(int depth, float x, float y, float mult, float h)
 {
 	m_depth=depth;
-	m_nbBranch = 2;
-	m_depthBranch = depth;
+    m_variant = rand()%CORAL_VARIANTS;
     m_x = x;
     m_y = y;
-    m_initialized = false;
     m_pivot = randomBetween(0.0, 90.0);
     m_height = h;
-
-	//Recursive
-	if (depth > 0) {
-		for (int i=0; i < m_nbBranch; i++) {
-			m_smallCorals.push_back(Coral(depth-1, 0, 0, randomBetween(minMult,maxMult), h));
-		}
-	}
-}
-
-void Coral::initDraw(int pass) {
-    m_list = glGenLists(1);
-    glNewList(m_list, GL_COMPILE);
-
-    m_coral.draw(pass);
-
-	vector<Coral>::iterator it;
-	int i=0;
-	for (it=m_smallCorals.begin(); it != m_smallCorals.end(); it++) {
-		if (i%2 == 0) {
-		    it->drawSub(pass, -defaultAngle);
-		} else {
-		    it->drawSub(pass, defaultAngle);
-		}			
-		i++;
-	}
-    glEndList();
+    // le tronc des arbres partagés a toujours le même mult
+    m_scale = CORAL_REF_MULT/mult;
 }
 
-void Coral::draw(int pass)
+void Coral::applyTransform() const
 {
-    if (!m_initialized) {
-        initDraw(pass);
-        m_initialized = true;
-    }
-
-    glPushMatrix();
-        if (pass == PASS_NORMAL)
-            TextureManager::bindTexture("corail1");
     //On le bouge
     glTranslatef(m_x, m_y, m_height);
-
     glRotatef(m_pivot, 0.0, 0.0, 1.0);
+    glScalef(m_scale, m_scale, m_scale);
+}
 
-    glCallList(m_list);
-
-    glPopMatrix();
+bool Coral::getBoundingSphere(glm::vec3 &center, float &radius) const
+{
+    center = glm::vec3(m_x, m_y, m_height);
+    radius = m_scale*getTemplate().getRadius();
+    return true;
 }
 
-void Coral::drawSub(int pass, int angle)
+void Coral::draw(int pass)
 {
     glPushMatrix();
-	//Decale les branches vers le haut
-	glTranslatef(0,0, m_coral.getHeigth() - m_depth/10.0/1.7);
-	//Pivote pour détacher le nouveau cylindre
-	glRotatef(angle,1,0,0);
-	//Pivote pour eviter d'aligner toutes les branches dans le même plan
-	glRotatef(angle*2,0,0,1);
-	m_coral.draw(pass);
-
-	vector<Coral>::iterator it;
-	int i=0;
-	for (it=m_smallCorals.begin(); it != m_smallCorals.end(); it++) {
-		if (i%2 == 0) {
-		    it->drawSub(pass, -defaultAngle);
-		} else {
-		    it->drawSub(pass, defaultAngle);
-		}			
-		i++;
-	}
+        if (pass == PASS_NORMAL)
+            TextureManager::bindTexture("corail1");
+    applyTransform();
+    getTemplate().draw();
     glPopMatrix();
-
 }
-
-
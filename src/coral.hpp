@@ -3,14 +3,19 @@
 
 #include <vector>
 #include "renderable.hpp"
-#include "cylinder.hpp"
-#include "viewer.hpp"
+#include "mesh.hpp"
 #ifndef __APPLE__
 #include <GL/glut.h>
 #else
 #include <GLUT/glut.h>
 #endif
 
+#define CORAL_VARIANTS 8 // arbres différents générés par profondeur
+#define CORAL_REF_MULT 4.f // mult du tronc des arbres générés
+
+// Un corail n'est plus qu'une instance d'un des arbres partagés (position,
+// pivot et échelle). Les arbres sont générés une seule fois et fusionnés
+// dans un Mesh chacun, cf Reef pour les dessiner tous d'un coup.
 class Coral : public Renderable
 {
     public:
@@ -21,26 +26,29 @@ class Coral : public Renderable
 		static const float maxMult = 5.0;
 
         void draw(int pass);
-        void drawSub(int pass, int angle);
-        Coral(int depth, int x, int y, float mutl, float h);
+        Coral(int depth, float x, float y, float mutl, float h);
         static inline float randomBetween(float min, float max) {
             return min + static_cast <float> (rand()) /( static_cast <float> (RAND_MAX/(max-min)));
         };
 
+        // arbre partagé numéro variant de profondeur depth
+        static Mesh& getTemplate(int depth, int variant);
+        inline Mesh& getTemplate() const { return getTemplate(m_depth, m_variant); }
+        // translation, pivot et échelle de l'instance
+        void applyTransform() const;
+        virtual bool getBoundingSphere(glm::vec3 &center, float &radius) const;
+
+        inline int getDepth() const { return m_depth; }
+        inline int getVariant() const { return m_variant; }
+
     private:
-		int m_nbBranch;
-		int m_depthBranch;
 		int m_depth;
-        int m_x;
-        int m_y;
-        bool m_initialized;
+        int m_variant;
+        float m_x;
+        float m_y;
         float m_pivot;
         float m_height;
-        GLuint m_list;
-		Cylinder m_coral; //root
-		std::vector<Coral> m_smallCorals;
-        
-        void initDraw(int pass);
+        float m_scale;
 };
 
 #endif
@@ -0,0 +1,143 @@
+#include "crowd.hpp"
+#include "skeleton.hpp"
+#include "parallel.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include <cstdlib>
+#include <cmath>
+
+// passe de pose sur les plongeurs [begin, end)
+struct CrowdPoseTask {
+    Crowd &crowd;
+    CrowdPoseTask(Crowd &c) : crowd(c) {}
+
+    void operator()(uint32_t begin, uint32_t end) const
+    {
+        const Skeleton &skel = DiverRig::getSkeleton();
+        const float half = CROWD_SPREAD/2.f;
+        glm::quat rot[DiverRig::j_count];
+        for (int j = 0; j < DiverRig::j_count; j++)
+            rot[j] = skel.getRotation(j);
+
+        for (uint32_t i = begin; i < end; i++) {
+            AnimationState &state = crowd.m_states[i];
+            glm::vec3 *pose = &crowd.m_poses[i*e_frame_type_count];
+            state.sample(pose);
+            state.advance();
+            for (int k = 0; k < e_frame_type_count; k++)
+                rot[DiverRig::getJoint((frame_type)k)] = Skeleton::euler(pose[k]);
+            float h = crowd.m_headings[i];
+            rot[DiverRig::j_torse] = Skeleton::axisAngle(h, glm::vec3(0.f, 0.f, 1.f))*rot[DiverRig::j_torse];
+
+            // on nage droit devant et on revient de l'autre côté du carré
+            glm::vec3 &p = crowd.m_positions[i];
+            p.x -= sin(h*M_PI/180.f)*CROWD_SPEED;
+            p.y += cos(h*M_PI/180.f)*CROWD_SPEED;
+            if (p.x < crowd.m_center.x - half) p.x += CROWD_SPREAD;
+            else if (p.x > crowd.m_center.x + half) p.x -= CROWD_SPREAD;
+            if (p.y < crowd.m_center.y - half) p.y += CROWD_SPREAD;
+            else if (p.y > crowd.m_center.y + half) p.y -= CROWD_SPREAD;
+
+            skel.evaluate(p, rot, &crowd.m_world[i*DiverRig::j_count]);
+        }
+    }
+};
+
+Crowd::Crowd(uint32_t nbDivers, const glm::vec3 &center) :
+    m_center(center),
+    m_positions(nbDivers),
+    m_headings(nbDivers),
+    m_states(nbDivers),
+    m_poses(nbDivers*e_frame_type_count),
+    m_world(nbDivers*DiverRig::j_count)
+{
+    const Animation *swim = DiverRig::getClip(DiverRig::e_swim);
+    for (uint32_t i = 0; i < nbDivers; i++) {
+        m_positions[i] = center + glm::vec3((rand()%1000/1000.f - 0.5f)*CROWD_SPREAD,
+                (rand()%1000/1000.f - 0.5f)*CROWD_SPREAD,
+                (rand()%1000/1000.f - 0.5f)*CROWD_SPREAD*0.1f);
+        m_headings[i] = (rand()%60) - 30.f;
+        // chacun à un moment différent de la nage
+        m_states[i].play(swim, &m_poses[i*e_frame_type_count]);
+        m_states[i].time = rand() % (int)(swim->getDuration()+1);
+    }
+
+    // mêmes formes que Torse, Arm, Leg et Fin
+    glm::mat4 id(1.f);
+    m_torse.addCylinder(id, DIVER_LENGTH, DIVER_WIDTH, CROWD_PRECISION);
+    m_bottle.addCylinder(id, 3.f, 1.f, CROWD_PRECISION);
+    m_head.addSphere(id, DIVER_HEAD_RADIUS, CROWD_PRECISION, CROWD_PRECISION);
+    m_arm.addSphere(id, 0.5f, CROWD_PRECISION, CROWD_PRECISION);
+    m_arm.addCylinder(glm::rotate(id, 90.f, glm::vec3(0.f, 1.f, 0.f)), DIVER_LIMB_LENGTH, 1.f, CROWD_PRECISION);
+    m_leg.addSphere(id, 0.5f, CROWD_PRECISION, CROWD_PRECISION);
+    m_leg.addCylinder(glm::rotate(id, 180.f, glm::vec3(0.f, 1.f, 0.f)), DIVER_LIMB_LENGTH, 1.f, CROWD_PRECISION);
+    m_fin.addCone(glm::translate(glm::rotate(id, -90.f, glm::vec3(1.f, 0.f, 0.f)), glm::vec3(0.f, 0.f, -0.5f)),
+            0.4f, 1.5f, 10, 2);
+
+    update();
+}
+
+void Crowd::update(uint32_t grain)
+{
+    parallelFor(m_positions.size(), CrowdPoseTask(*this), grain);
+}
+
+void Crowd::animate()
+{
+    update();
+}
+
+void Crowd::drawJoint(Mesh &mesh, DiverRig::joint_t joint)
+{
+    for (uint32_t i = 0; i < m_positions.size(); i++) {
+        glPushMatrix();
+        glMultMatrixf(&m_world[i*DiverRig::j_count + joint][0][0]);
+        mesh.drawElements();
+        glPopMatrix();
+    }
+}
+
+void Crowd::draw(int pass)
+{
+    if (m_positions.empty())
+        return;
+    if (pass == PASS_NORMAL)
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_torse.bind();
+    glColor3f(152/255.0f,87/255.0f,23/255.0f);
+    drawJoint(m_torse, DiverRig::j_torse);
+    m_torse.unbind();
+
+    m_bottle.bind();
+    glColor3f(237/255.0f,255/255.0f,12/255.0f);
+    drawJoint(m_bottle, DiverRig::j_bottle);
+    m_bottle.unbind();
+
+    m_head.bind();
+    glColor3f(175/255.0f,175/255.0f,175/255.0f);
+    drawJoint(m_head, DiverRig::j_head);
+    m_head.unbind();
+
+    m_arm.bind();
+    glColor3f(237/255.0f,255/255.0f,12/255.0f);
+    drawJoint(m_arm, DiverRig::j_armUR);
+    drawJoint(m_arm, DiverRig::j_armUL);
+    glColor3f(175/255.0f,175/255.0f,175/255.0f);
+    drawJoint(m_arm, DiverRig::j_armLR);
+    drawJoint(m_arm, DiverRig::j_armLL);
+    m_arm.unbind();
+
+    m_leg.bind();
+    glColor3f(118/255.0f,32/255.0f,1/255.0f);
+    drawJoint(m_leg, DiverRig::j_legUR);
+    drawJoint(m_leg, DiverRig::j_legUL);
+    glColor3f(175/255.0f,175/255.0f,175/255.0f);
+    drawJoint(m_leg, DiverRig::j_legLR);
+    drawJoint(m_leg, DiverRig::j_legLL);
+    m_leg.unbind();
+
+    m_fin.bind();
+    drawJoint(m_fin, DiverRig::j_finR);
+    drawJoint(m_fin, DiverRig::j_finL);
+    m_fin.unbind();
+}
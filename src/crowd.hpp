@@ -0,0 +1,57 @@
+#ifndef __CROWD_H__
+#define __CROWD_H__
+/*******************************************************************************
+ *  Crowd                                                                      *
+ *  Thu Jun 05 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include "renderable.hpp"
+#include "animation.hpp"
+#include "diverRig.hpp"
+#include "mesh.hpp"
+#include <vector>
+#include <stdint.h>
+#include "glm/vec3.hpp"
+#include "glm/mat4x4.hpp"
+
+#define CROWD_SPREAD 150.f // côté du carré dans lequel nagent les plongeurs
+#define CROWD_SPEED 0.15f
+#define CROWD_PRECISION 8 // faces des cylindres et sphères
+#define CROWD_GRAIN 64 // plongeurs par tranche pour les threads
+
+// Un banc de plongeurs qui partagent le squelette et les animations de
+// DiverRig. L'état de chaque plongeur est rangé en tableaux contigus et
+// toutes les poses sont calculées en une seule passe répartie sur les
+// threads, sans appel OpenGL. draw bind ensuite chaque partie du corps une
+// seule fois pour tous les plongeurs.
+class Crowd : public Renderable {
+    friend struct CrowdPoseTask;
+
+    glm::vec3 m_center;
+    std::vector<glm::vec3> m_positions;
+    std::vector<float> m_headings; // autour de z, en degrés
+    std::vector<AnimationState> m_states;
+    std::vector<glm::vec3> m_poses; // e_frame_type_count par plongeur
+    std::vector<glm::mat4> m_world; // DiverRig::j_count par plongeur
+
+    Mesh m_torse, m_bottle, m_head, m_arm, m_leg, m_fin;
+
+    void drawJoint(Mesh &mesh, DiverRig::joint_t joint);
+
+public:
+    Crowd(uint32_t nbDivers, const glm::vec3 &center);
+
+    // avance les animations et recalcule toutes les matrices, par tranches
+    // de grain plongeurs
+    void update(uint32_t grain = CROWD_GRAIN);
+    void animate();
+    void draw(int pass);
+
+    inline uint32_t getNbDivers() const { return m_positions.size(); }
+    inline const glm::mat4* getWorld(uint32_t diver) const { return &m_world[diver*DiverRig::j_count]; }
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include <iostream>
 using namespace std;
 #include "cylinder.hpp"
+#include "mesh.hpp"
 #include <cmath>
 
 Cylinder::Cylinder(float heigth, float width, int nb_face) {
@@ -10,6 +11,11 @@ Cylinder::Cylinder(float heigth, float width, int nb_face) {
 }
 
 void Cylinder::draw(int pass)
+{
+    draw(pass, 0);
+}
+
+void Cylinder::draw(int pass, int level)
 {
     glPushMatrix();
 
@@ -22,7 +28,7 @@ void Cylinder::draw(int pass)
 
     // draw elements (right cube)
     //glTranslatef(+4, 0, 0);
-    drawElements();
+    drawElements(level);
 
     glPopMatrix();
 }
@@ -106,60 +112,11 @@ void Cylinder::drawArrays()
 
 //==================== 3. Arrays - drawElements ==============================
 // - single definition of shared data
-// - draw face by face, using face indices
+// - the tessellation is computed once and kept in a retained buffer, cf Mesh
 
-// TODO on devrais calcule une seule fois pas +a chaque draw
-void Cylinder::drawElements()
+void Cylinder::drawElements(int level)
 {
-    GLfloat vertices[nb_face*3*2];//top bot top bot ...
-    GLfloat texcoords[nb_face*2*2];//top bot top bot ...
-    GLfloat normals[nb_face][3];
-    GLubyte indices[nb_face][4];
-    GLubyte indices_top_bot[2][nb_face];
-
-    for (int i = 0; i < nb_face; i++) {
-        normals[i][0] = cos((i+0.5/nb_face)*2*M_PI/nb_face);
-        normals[i][1] = sin((i+0.5/nb_face)*2*M_PI/nb_face);
-        normals[i][2] = 0;
-        vertices[i*3*2    ] = cos(i*2*M_PI/nb_face)*0.5*this->width;
-        texcoords[i*2*2   ] = (float)i/nb_face;
-        vertices[i*3*2+3  ] = cos(i*2*M_PI/nb_face)*0.5*this->width;
-        texcoords[i*2*2+2 ] = (float)i/nb_face;
-        vertices[i*3*2  +1] = sin(i*2*M_PI/nb_face)*0.5*this->width;
-        vertices[i*3*2+3+1] = sin(i*2*M_PI/nb_face)*0.5*this->width;
-        vertices[i*3*2  +2] = this->heigth;
-        texcoords[i*2*2 +1] = 1.f;
-        vertices[i*3*2+3+2] = 0.0;
-        texcoords[i*2*2+2+1] = 0.f;
-        indices_top_bot[0][i] = i*2;
-        indices_top_bot[1][i] = i*2+1;
-        indices[i][0] = i*2;
-        indices[i][1] = i*2+1;
-        indices[i][2] = (i*2+3)%(2*nb_face);
-        indices[i][3] = (i*2+2)%(2*nb_face);
-    }
-
-    // activate the use of GL_VERTEX_ARRAY (not GL_NORMALS_ARRAY)
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0 , vertices);
-    glTexCoordPointer(2, GL_FLOAT, 0 , texcoords);
-
-    // Draw the top
-    glNormal3f(0,0,1);
-    glDrawElements(GL_POLYGON, nb_face, GL_UNSIGNED_BYTE, indices_top_bot[0]);
-
-    //Draw the bottom
-    glNormal3f(0,0,-1);
-    glDrawElements(GL_POLYGON, nb_face, GL_UNSIGNED_BYTE, indices_top_bot[1]);
-
-    //Draw the rest
-    for (int i = 0; i < nb_face; i++) {
-        glNormal3fv(normals[i]);
-        glDrawElements(GL_QUADS, 4, GL_UNSIGNED_BYTE, indices[i]);
-    }
-
-    glDisableClientState(GL_VERTEX_ARRAY);
+    Mesh::cylinder(heigth, width, nb_face, level).draw();
 }
 
 
@@ -14,10 +14,12 @@ class Cylinder : public Renderable
         Cylinder(float, float, int);
 		float getHeigth();
         void draw(int pass);
+        // level: niveau de précision, cf Mesh::primitive
+        void draw(int pass, int level);
 
     private:
         void drawImmediate();
-        void drawElements();
+        void drawElements(int level = 0);
         void drawArrays();
         int nb_face;
         float heigth, width;
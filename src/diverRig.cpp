@@ -0,0 +1,142 @@
+#include "diverRig.hpp"
+
+Skeleton *DiverRig::s_skeleton = NULL;
+Animation *DiverRig::s_clips[DiverRig::e_clip_count];
+
+const Skeleton& DiverRig::getSkeleton()
+{
+    if (!s_skeleton)
+        build();
+    return *s_skeleton;
+}
+
+const Animation* DiverRig::getClip(clip_t c)
+{
+    if (!s_skeleton)
+        build();
+    return s_clips[c];
+}
+
+DiverRig::joint_t DiverRig::getJoint(frame_type t)
+{
+    static const joint_t joints[e_frame_type_count] = {
+        j_armUL, j_armLL, j_armUR, j_armLR,
+        j_legUL, j_legLL, j_legUR, j_legLR,
+        j_torse, j_head
+    };
+    return joints[t];
+}
+
+void DiverRig::build()
+{
+    Skeleton &s = *(s_skeleton = new Skeleton());
+    s.addJoint(-1, glm::vec3()); // j_torse
+    s.addJoint(j_torse, glm::vec3(0, -1.3f, 0.1f)); // j_bottle
+    s.addJoint(j_torse, glm::vec3(0, 0, DIVER_LENGTH)); // j_head
+    s.addJoint(j_torse, glm::vec3(DIVER_WIDTH/2.0*1.1, 0, DIVER_LENGTH*0.80)); // j_armUR
+    s.addJoint(j_armUR, glm::vec3(DIVER_LIMB_LENGTH, 0, 0)); // j_armLR
+    s.addJoint(j_torse, glm::vec3(-(DIVER_WIDTH/2.0*1.1), 0, DIVER_LENGTH*0.80)); // j_armUL
+    s.addJoint(j_armUL, glm::vec3(DIVER_LIMB_LENGTH, 0, 0)); // j_armLL
+    s.addJoint(j_armLL, glm::vec3(DIVER_LIMB_LENGTH, 0, 0)); // j_weapon
+    s.addJoint(j_torse, glm::vec3(DIVER_WIDTH/2.0*0.7, 0, 0)); // j_legUR
+    s.addJoint(j_legUR, glm::vec3(0, 0, -DIVER_LIMB_LENGTH)); // j_legLR
+    s.addJoint(j_legLR, glm::vec3(0, 0.5, -DIVER_LIMB_LENGTH)); // j_finR
+    s.addJoint(j_torse, glm::vec3(-(DIVER_WIDTH/2.0*0.7), 0, 0)); // j_legUL
+    s.addJoint(j_legUL, glm::vec3(0, 0, -DIVER_LIMB_LENGTH)); // j_legLL
+    s.addJoint(j_legLL, glm::vec3(0, 0.5, -DIVER_LIMB_LENGTH)); // j_finL
+
+    // articulations fixes
+    s.setRotation(j_weapon, glm::vec3(90, -53, -90));
+    s.setRotation(j_finR, glm::vec3(-60, 0, 0));
+    s.setRotation(j_finL, glm::vec3(-60, 0, 0));
+    s.update();
+
+    Animation &swim = *(s_clips[e_swim] = new Animation(30)),
+              &getUp = *(s_clips[e_getUp] = new Animation(30)),
+              &swimTrans = *(s_clips[e_swimTrans] = new Animation(30)),
+              &aim = *(s_clips[e_aim] = new Animation(30)),
+              &recoil = *(s_clips[e_recoil] = new Animation(10)),
+              &headUp = *(s_clips[e_headUp] = new Animation(30));
+
+    float tmp = 10;
+    swim.addFrame(0, e_torse, glm::vec3(-90, 0, -tmp));
+    swim.addFrame(0, e_head, glm::vec3(15, 0, tmp));
+
+    swim.addFrame(0, e_legUL, glm::vec3(15, 0, 0));
+    swim.addFrame(0, e_legLL, glm::vec3(0, 0, 0));
+    swim.addFrame(0, e_legUR, glm::vec3(-15, 0, 0));
+    swim.addFrame(0, e_legLR, glm::vec3(-tmp, 0, 0));
+
+    swim.addFrame(0, e_armUL, glm::vec3(0, -75, 180));
+    swim.addFrame(0, e_armUR, glm::vec3(0, 75, 10));
+    swim.addFrame(0, e_armLL, glm::vec3(0, 0, 0));
+    swim.addFrame(0, e_armLR, glm::vec3(0, 0, 0));
+
+    swim.addFrame(14, e_torse, glm::vec3(-90, 0, tmp));
+    swim.addFrame(14, e_head, glm::vec3(15, 0, -tmp));
+    swim.addFrame(14, e_legUL, glm::vec3(-15, 0, 0));
+    swim.addFrame(14, e_legLL, glm::vec3(-tmp, 0, 0));
+    swim.addFrame(14, e_legUR, glm::vec3(15, 0, 0));
+    swim.addFrame(14, e_legLR, glm::vec3(0, 0, 0));
+    swim.addFrame(14, e_armUL, glm::vec3(0, -75, 170));
+    swim.addFrame(14, e_armUR, glm::vec3(0, 75, 0));
+
+    swim.addFrame(29, e_torse, glm::vec3(-90, 0, -tmp));
+    swim.addFrame(29, e_head, glm::vec3(15, 0, tmp));
+    swim.addFrame(29, e_legUL, glm::vec3(15, 0, 0));
+    swim.addFrame(29, e_legLL, glm::vec3(0, 0, 0));
+    swim.addFrame(29, e_legUR, glm::vec3(-15, 0, 0));
+    swim.addFrame(29, e_legLR, glm::vec3(-tmp, 0, 0));
+    swim.addFrame(29, e_armUL, glm::vec3(0, -75, 180));
+    swim.addFrame(29, e_armUR, glm::vec3(0, 75, 10));
+
+
+    // animation pour se redresser
+    getUp.addFrameFromCurrent(0);
+    getUp.addFrame(29, e_torse, glm::vec3(-5, 0, 0));
+    getUp.addFrame(29, e_head, glm::vec3(20, 0, 0));
+    getUp.addFrame(29, e_armUL, glm::vec3(0, -75, 180));
+    getUp.addFrame(29, e_armLL, glm::vec3());
+    getUp.addFrame(29, e_armUR, glm::vec3(0, 75, 10));
+    getUp.addFrame(29, e_armLR, glm::vec3());
+    getUp.addFrame(29, e_legUL, glm::vec3(0, 15, 0));
+    getUp.addFrame(29, e_legLL, glm::vec3());
+    getUp.addFrame(29, e_legUR, glm::vec3(0, -15, 0));
+    getUp.addFrame(29, e_legLR, glm::vec3());
+
+    // Animation pour se remettre à nager
+    swimTrans.addFrameFromCurrent(0);
+    swimTrans.addFrame(19, e_torse, glm::vec3(-90, 0, -tmp));
+    swimTrans.addFrame(19, e_head, glm::vec3(15, 0, tmp));
+    swimTrans.addFrame(19, e_legUL, glm::vec3(15, 0, 0));
+    swimTrans.addFrame(19, e_legLL, glm::vec3(0, 0, 0));
+    swimTrans.addFrame(19, e_legUR, glm::vec3(-15, 0, 0));
+    swimTrans.addFrame(19, e_legLR, glm::vec3(-tmp, 0, 0));
+    swimTrans.addFrame(19, e_armUL, glm::vec3(0, -75, 180));
+    swimTrans.addFrame(19, e_armUR, glm::vec3(0, 75, 10));
+    swimTrans.addFrame(19, e_armLL, glm::vec3(0, 0, 0));
+    swimTrans.addFrame(19, e_armLR, glm::vec3(0, 0, 0));
+
+    // Animation pour sortir l'arme et viser
+    aim.addFrameFromCurrent(0);
+    aim.addFrame(7, e_armUL, glm::vec3(10, 75, 180));
+    aim.addFrame(7, e_armLL, glm::vec3(0, 0, 0));
+    aim.addFrame(13, e_armUL, glm::vec3(10, 75, 180));
+    aim.addFrame(13, e_armLL, glm::vec3(0, 0, 90));
+    aim.addFrame(19, e_armUL, glm::vec3(-90, 75, 180));
+    aim.addFrame(19, e_armLL, glm::vec3(0, 0, 90));
+    aim.addFrame(19, e_armUR, glm::vec3(-30, 75, 180));
+    aim.addFrame(19, e_armLR, glm::vec3(0, 45, 0));
+    aim.addFrame(15, e_torse);
+    aim.addFrame(19, e_torse, glm::vec3(0, 0, -10));
+
+    // Animation pour le recul apres le coup de feu
+    recoil.addFrameFromCurrent(0);
+    recoil.addFrame(9, e_legUL, glm::vec3(75, 35, 0));
+    recoil.addFrame(9, e_legUR, glm::vec3(75, -35, 0));
+
+    // ANimation pour lever la tête face au requin
+    // Animation pour le recul apres le coup de feu
+    headUp.addFrameFromCurrent(0);
+    headUp.addFrame(29, e_head, glm::vec3(35, 0, 0));
+}
@@ -0,0 +1,65 @@
+#ifndef __DIVERRIG_H__
+#define __DIVERRIG_H__
+/*******************************************************************************
+ *  DiverRig                                                                   *
+ *  Thu Jun 05 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include "skeleton.hpp"
+#include "animation.hpp"
+#include "globals.hpp"
+
+#define DIVER_LENGTH 4.f
+#define DIVER_WIDTH 2.f
+#define DIVER_HEAD_RADIUS 1.2f
+#define DIVER_LIMB_LENGTH 2.f // bras et jambes, cf Arm et Leg
+
+// Données communes à tous les plongeurs: le squelette de référence et les
+// animations. Elles sont construites une seule fois et ne changent plus,
+// chaque plongeur n'a que sa pose et son AnimationState.
+class DiverRig {
+public:
+    // articulations du squelette, un parent avant ses enfants
+    enum joint_t {
+        j_torse,
+        j_bottle,
+        j_head,
+        j_armUR,
+        j_armLR,
+        j_armUL,
+        j_armLL,
+        j_weapon,
+        j_legUR,
+        j_legLR,
+        j_finR,
+        j_legUL,
+        j_legLL,
+        j_finL,
+        j_count
+    };
+
+    enum clip_t {
+        e_swim,
+        e_getUp,
+        e_swimTrans,
+        e_aim,
+        e_recoil,
+        e_headUp,
+        e_clip_count
+    };
+
+    static const Skeleton& getSkeleton();
+    static const Animation* getClip(clip_t c);
+    // articulation animée par chaque frame_type
+    static joint_t getJoint(frame_type t);
+
+private:
+    static Skeleton *s_skeleton;
+    static Animation *s_clips[e_clip_count];
+    static void build();
+};
+
+#endif
@@ -1,10 +1,15 @@
 #include <cmath>
 #include <iostream>
-#include <map>
 using namespace std;
 
 #include "viewer.hpp"
 #include "dynamicSystem.hpp"
+#include "mesh.hpp"
+
+static inline glm::vec3 toCore(const Vec &v)
+{
+	return glm::vec3(v.x, v.y, v.z);
+}
 
 
 DynamicSystem::DynamicSystem()
@@ -27,55 +32,71 @@ DynamicSystem::~DynamicSystem()
 
 void DynamicSystem::clear()
 {
-	vector<Particle *>::iterator itP;
-	for (itP = particles.begin(); itP != particles.end(); ++itP) {
- 		delete(*itP);
-	}
-	particles.clear();
+	core.clear();
+	blues.clear();
+}
 
-	vector<Spring *>::iterator itS;
-	for (itS = springs.begin(); itS != springs.end(); ++itS) {
- 		delete(*itS);
-	}
-	springs.clear();
+uint32_t DynamicSystem::addParticle(const Vec &pos, const Vec &vel, double m, double r)
+{
+	blues.push_back(false);
+	return core.addParticle(toCore(pos), toCore(vel), m, r);
+}
+
+void DynamicSystem::addSpring(uint32_t a, uint32_t b, double s, double l0, double d)
+{
+	core.addSpring(a, b, s, l0, d);
 }
 
-const Vec &DynamicSystem::getFixedParticlePosition() const
+Vec DynamicSystem::getFixedParticlePosition() const
 {
-	return particles[0]->getPosition();	// no check on 0!
+	return Vec(core.getPosition(0));	// no check on 0!
 }
 
 void DynamicSystem::setBeginingPosition(const Vec &pos)
 {
-	if (particles.size() > 0)
-		particles[0]->setPosition(pos);
+	if (core.getNbParticles() > 0)
+		core.setPosition(0, toCore(pos));
 }
 
 void DynamicSystem::setEndPosition(const Vec &pos)
 {
-	if (particles.size() > 0)
-		particles[springs.size()]->setPosition(pos);
+	if (core.getNbParticles() > 0)
+		core.setPosition(core.getNbSprings(), toCore(pos));
 }
 
 void DynamicSystem::setEndParticlePosition(const Vec &pos)
 {
-	if (particles.size() > 0)
-		particles[particles.size()-1]->setPosition(pos);
+	if (core.getNbParticles() > 0)
+		core.setPosition(core.getNbParticles()-1, toCore(pos));
 }
 
 void DynamicSystem::setGravity(bool onOff)
 {
 	gravity = (onOff ? defaultGravity : Vec());
+	core.setGravity(toCore(gravity));
 }
 
 void DynamicSystem::setViscosity(bool onOff)
 {
 	mediumViscosity = (onOff ? defaultMediumViscosity : 0.0);
+	core.setViscosity(mediumViscosity);
 }
 
 void DynamicSystem::setCollisionsDetection(bool onOff)
 {
 	handleCollisions = onOff;
+	core.setCollisions(handleCollisions);
+}
+
+void DynamicSystem::setIntegrator(Core::integrator_t i)
+{
+	core.setIntegrator(i);
+}
+
+void DynamicSystem::setTimeStep(double t)
+{
+	dt = t;
+	core.setTimeStep(dt);
 }
 
 
@@ -85,6 +106,7 @@ void DynamicSystem::init(Vec v)
 	toggleGravity = true;
 	toggleViscosity = true;
 	toggleCollisions = true;
+	toggleImplicit = core.getIntegrator() == Core::e_implicit;
 	clear();
 	
 	// global scene parameters 
@@ -106,6 +128,13 @@ void DynamicSystem::init(Vec v)
 	springInitLength = 0.5;
 	springDamping = 1.0;
 
+	core.setGravity(toCore(gravity));
+	core.setViscosity(mediumViscosity);
+	core.setTimeStep(dt);
+	core.setRebound(rebound);
+	core.setGround(toCore(groundPosition), toCore(groundNormal));
+	core.setCollisions(handleCollisions);
+
 	createSystemScene(v);
 	// or another method, e.g. to test collisions on simple cases...
 // 	createTestCollisions();
@@ -123,7 +152,7 @@ void DynamicSystem::createSystemScene(Vec v)
 {
 	// add a fixed particle
 	Vec initPos = v;
-	particles.push_back(new Particle(initPos, Vec(), 0.0, particleRadius));
+	addParticle(initPos, Vec(), 0.0, particleRadius);
 
     int nParts(5);
 
@@ -132,16 +161,15 @@ void DynamicSystem::createSystemScene(Vec v)
         vel(0.0, 0.0, 0.0);
     for (int i = 0; i < nParts; ++i) {
         pos = initPos + Vec(0.0, -distanceBetweenParticles*(i+1), 0.0);
-        particles.push_back(new Particle(pos, vel, i==nParts-1?0.0:particleMass, particleRadius));
+        addParticle(pos, vel, i==nParts-1?0.0:particleMass, particleRadius);
         l0 = pos - prevPos;
 
-        Spring *spr = new Spring(particles[i], particles[i+1], springStiffness, l0.norm(), springDamping);
-        springs.push_back(spr);
+        addSpring(i, i+1, springStiffness, l0.norm(), springDamping);
 
         prevPos = pos;
     }
-    particles.push_back(new Particle(Vec(v), Vec(0.0, 0.0, 0.0), 0, particleRadius*5.0));
-    particles.back()->blue = true;
+    addParticle(Vec(v), Vec(0.0, 0.0, 0.0), 0, particleRadius*5.0);
+    blues.back() = true;
 
 }
 
@@ -149,22 +177,35 @@ void DynamicSystem::createSystemScene(Vec v)
 ///////////////////////////////////////////////////////////////////////////////
 void DynamicSystem::draw(int pass)
 {
-	// Particles
-	glColor3f(1,0,0);
-	vector<Particle *>::iterator itP;
-	for (itP = particles.begin(); itP != particles.end(); ++itP) {
-        if(itP+1 != particles.end())
-    		(*itP)->draw(pass);
+	// Particles, except the last one
+	Mesh &sphere = Mesh::sphere(1.f, 12, 12);
+	sphere.bind();
+	for (uint32_t i = 0; i+1 < core.getNbParticles(); ++i) {
+		const glm::vec3 &pos = core.getPosition(i);
+		float r = core.getRadius(i);
+		glPushMatrix();
+		if (blues[i])
+			glColor3f(0.f, 0.f, 1.f);
+		else
+			glColor3f(1,0,0);
+		glTranslatef(pos.x, pos.y, pos.z);
+		glScalef(r, r, r);
+		sphere.drawElements();
+		glPopMatrix();
 	}
+	sphere.unbind();
 
 	// Springs
 	glColor3f(1.0, 0.28, 0.0);
 	glLineWidth(5.0);
-	vector<Spring *>::iterator itS;
-    int nb = 0;
-	for (itS = springs.begin(); itS != springs.end(); ++itS) {
-    	(*itS)->draw(pass);
+	glBegin(GL_LINES);
+	for (uint32_t i = 0; i < core.getNbSprings(); ++i) {
+		const glm::vec3 &pos1 = core.getPosition(core.getSpringA(i)),
+			&pos2 = core.getPosition(core.getSpringB(i));
+		glVertex3f(pos1.x, pos1.y, pos1.z);
+		glVertex3f(pos2.x, pos2.y, pos2.z);
 	}
+	glEnd();
 	glLineWidth(1.0);
 }
 
@@ -172,121 +213,11 @@ void DynamicSystem::draw(int pass)
 ///////////////////////////////////////////////////////////////////////////////
 void DynamicSystem::animate()
 {
-
-//======== 1. Compute all forces
-	// map to accumulate the forces to apply on each particle
-	map<const Particle *, Vec> forces;
-
-	// weights
-	vector<Particle *>::iterator itP;
-	for (itP = particles.begin(); itP != particles.end(); ++itP) {
-		Particle *p = *itP;
-		forces[p] = gravity * p->getMass();
-        forces[p] += -mediumViscosity * p->getVelocity();
-	}
-
-	// damped springs
-	vector<Spring *>::iterator itS;
-	for (itS = springs.begin(); itS != springs.end(); ++itS) {
-		Spring *s = *itS;
-		Vec f12 = s->getCurrentForce();
-		forces[s->getParticle1()] += f12;
-		forces[s->getParticle2()] -= f12; // opposite force
-	}
-
-
-//======== 2. Integration scheme
-
-	// update particles speed
-	for (itP = particles.begin(); itP != particles.end(); ++itP) {
-		Particle *p = *itP;
-        // v = v + dt * a/m
-		p->incrVelocity(dt * (forces[p] * p->getInvMass()));
-	}
-
-	// update particles positions
-	for (itP = particles.begin(); itP != particles.end(); ++itP) {
-		Particle *p = *itP;
-		// q = q + dt * v
-        // v = v + dt * a/m
-		p->incrPosition(dt * p->getVelocity());
-	}
-
-
-//======== 3. Collisions
-	if (handleCollisions) {
-		//TO DO: discuss multi-collisions and order!
-                // XXX Not neede here
-		//for (itP = particles.begin(); itP != particles.end(); ++itP) {
-			//collisionParticleGround(*itP);
-		//}	
-		for(unsigned int i = 0; i < particles.size(); ++i) {
-			for(unsigned int j = 1; j < particles.size(); ++j) {
-				if ( i != j) {
-					Particle *p1 = particles[j]; 
-					Particle *p2 = particles[i];
-	            	collisionParticleParticle(p1, p2);
-	            }
-        	}
-		}
-	}
-}
-
-
-
-void DynamicSystem::collisionParticleGround(Particle *p)
-{
-	// don't process fixed particles (ground plane is fixed)
-	if (p->getInvMass() == 0)
-		return;
-
-	// particle-plane distance
-	double penetration = (p->getPosition() - groundPosition) * groundNormal;
-	penetration -= p->getRadius();
-	if (penetration >= 0)
-		return;
-
-	// penetration velocity
-	double vPen = p->getVelocity() * groundNormal;
-
-	// updates position and velocity of the particle
-	p->incrPosition(-penetration * groundNormal);
-	p->incrVelocity(-(1 + rebound) * vPen * groundNormal);
+	// forces, integration scheme and collisions
+	core.step();
 }
 
 
-void DynamicSystem::collisionParticleParticle(Particle *p1, Particle *p2)
-{
-	if (p1->getInvMass() == 0)
-    return;
-
-    Vec p(p2->getPosition() - p1->getPosition());
-
-    double penetration = p.norm() - p1->getRadius() - p2->getRadius();
-
-    if (penetration >= 0.0)
-        return;
-
-    p.normalize();
-
-    //std::cout<<"Collision\n";
-
-    Vec vel(p1->getVelocity() - p2->getVelocity());
-
-    p1->incrPosition(penetration*p*0.5);
-    //p1->incrVelocity(-p1->getVelocity()*p1->getMass()/(p1->getMass()+p2->getMass()));
-    p1->incrVelocity(-p2->getMass()/(p1->getMass()+p2->getMass())
-                    *(p*vel)*(1.0+rebound)*p);
-
-    if (p2->getInvMass() == 0.0)
-        return;
-    p *= -1.0;
-    p2->incrPosition(penetration*p*0.5);
-    //p2->incrVelocity(-p2->getVelocity()*p2->getMass()/(p1->getMass()+p2->getMass()));
-    p2->incrVelocity(p1->getMass()/(p1->getMass()+p2->getMass())
-                   *(p*vel)*(1.0+rebound)*p);
-}
-
 
 void DynamicSystem::keyPressEvent(QKeyEvent* e, Viewer& viewer)
 {
@@ -312,6 +243,12 @@ void DynamicSystem::keyPressEvent(QKeyEvent* e, Viewer& viewer)
 		viewer.displayMessage("Detects collisions "
 			+ (toggleCollisions ? QString("true") : QString("false")));
 
+	} else if ((e->key()==Qt::Key_I) && (modifiers==Qt::NoButton)) {
+		toggleImplicit = !toggleImplicit;
+		setIntegrator(toggleImplicit ? Core::e_implicit : Core::e_explicit);
+		viewer.displayMessage("Implicit integration "
+			+ (toggleImplicit ? QString("true") : QString("false")));
+
 	} else if ((e->key()==Qt::Key_Home) && (modifiers==Qt::NoButton)) {
 		// stop the animation, and reinit the scene
 		viewer.stopAnimation();
@@ -8,10 +8,10 @@ using namespace qglviewer;
 #include <vector>
 using namespace std;
 
-#include "spring.hpp"
-#include "particle.hpp"
+#include <stdint.h>
 #include "renderable.hpp"
 #include "TextureManager.hpp"
+#include "springSystem.hpp"
 
 /*
  * This class represents a dynamic system made of particles
@@ -20,14 +20,20 @@ using namespace std;
  * Particles a represented by small spheres, with a radius and a mass.
  * The initial scene is composed of a fixed plane, a static particle
  * that can be controlled by the mouse, and a dynamic particle.
+ * The simulation itself is done by SpringSystem, in single precision and
+ * without QGLViewer; this class converts from and to qglviewer::Vec, draws
+ * the system and handles the lab controls.
+ * Particle and Spring are only kept for the legacy benchmark.
  */
 class DynamicSystem : public Renderable
 {
 
+public:
+	typedef SpringSystem<float, glm::vec3> Core;
+
 private:
-	// system
-	vector<Particle *> particles;
-	vector<Spring *> springs;
+	Core core;
+	vector<bool> blues;	// drawn in blue instead of red
 	
 	// System parameters (common)
 	Vec defaultGravity;
@@ -56,6 +62,7 @@ private:
 	bool toggleGravity;
 	bool toggleViscosity;
 	bool toggleCollisions;
+	bool toggleImplicit;
 
 	GLuint tx_nyan;
 
@@ -64,7 +71,7 @@ public:
 	virtual ~DynamicSystem();
 
 	// Position of the firt particle ca be set through mouse movements
-	const Vec &getFixedParticlePosition() const;
+	Vec getFixedParticlePosition() const;
 	void setEndPosition(const Vec &pos);
 	void setBeginingPosition(const Vec &pos);
     void setEndParticlePosition(const Vec &pos);
@@ -74,19 +81,24 @@ public:
 	void setViscosity(bool onOff);
 	// Activate/desactivate contacts during the simulation
 	void setCollisionsDetection(bool onOff);
+	// Explicit by default; implicit stays stable with stiff springs at a
+	// large time step, at the cost of a CG solve per step
+	void setIntegrator(Core::integrator_t i);
+	void setTimeStep(double t);
 
 	// event response
 	void keyPressEvent(QKeyEvent*, Viewer&);
-	
-private:
+
 	// Reset the scene (remove all particles and springs)
 	void clear();
-	
-	// Compute collision between a sphere and the fixed) ground
-	void collisionParticleGround(Particle *p);
-
-	void collisionParticleParticle(Particle *p1, Particle *p2);
+	// Add a particle (mass 0 for a fixed one), returns its index
+	uint32_t addParticle(const Vec &pos, const Vec &vel, double m, double r);
+	// Add a damped spring between particles a and b
+	void addSpring(uint32_t a, uint32_t b, double s, double l0, double d);
 
+	inline const Core &getCore() const { return core; }
+	
+private:
 	// Compute collision between a sphere and a moving plane
 // 	static void collisionParticlePlane(Particle *p,
 // 		Vec planePosition, Vec placeNormal, Vec planeVelocity,
@@ -2,6 +2,7 @@
 using namespace std;
 #include "cylinder.hpp"
 #include "fin.hpp"
+#include "mesh.hpp"
 #include <cmath>
 
 
@@ -17,6 +18,6 @@ void Fin::draw(int pass)
     glEnd();
 	glRotatef(-90,1,0,0);
 	glTranslatef(0,0,-0.5);
-	glutSolidCone(0.4,1.5,10,2);
+	Mesh::cone(0.4,1.5,10,2).draw();
     glPopMatrix();
 }
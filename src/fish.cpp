@@ -320,6 +320,23 @@ bool Fish::update( float dt, uint32_t schoolID, std::vector< Fish > &school, glm
 
 
 
+RenderQueue::Material Fish::getMaterial() const
+{
+    return RenderQueue::Material(m_colour, glm::vec4(0, 0.5, 1, 0.5));
+}
+
+GLuint Fish::getTexture() const
+{
+    return m_model->getTexture();
+}
+
+bool Fish::getBoundingSphere(glm::vec3 &center, float &radius) const
+{
+    center = m_pos;
+    radius = m_model->getOriginRadius();
+    return true;
+}
+
 // Draw Fish
 void Fish::draw(int pass) {
 
@@ -394,16 +411,6 @@ void Fish::draw(int pass) {
     float velRatio = glm::length(m_vel) / MAX_VELOCITY;
     glPushMatrix();
 
-    GLfloat amDef[4], spDef[4];
-    GLfloat am[] = { m_colour[0], m_colour[1], m_colour[2], 1 };
-    GLfloat sp[] = { 0, 0.5, 1, 0.5 };
-
-    glGetMaterialfv( GL_FRONT_AND_BACK, GL_AMBIENT, amDef );
-    glGetMaterialfv( GL_FRONT_AND_BACK, GL_SPECULAR, spDef );
-
-    glMaterialfv( GL_FRONT_AND_BACK, GL_AMBIENT, am );
-    glMaterialfv( GL_FRONT_AND_BACK, GL_SPECULAR, sp );
-
     // Head
     //glRotatef( velRatio * 0.8 * m_swimAngle, 0, 1, 0 );
     //glutSolidCone( 0.2, 0.4, 5, 1 );
@@ -412,7 +419,7 @@ void Fish::draw(int pass) {
     glRotatef( 180 - velRatio * m_swimAngle, 0, 1, 0 );
     //glutSolidCone( 0.1, 0.5, 5, 1 );
     glColor4f(1.f, 1.f, 1.f, 1.f);
-    m_model->draw(pass);
+    m_model->drawFaces();
     //glPushMatrix();
     //glTranslatef( 0, 0, 0.1 );
     //glRotatef( -65, 1, 0, 0 );
@@ -427,9 +434,6 @@ void Fish::draw(int pass) {
     //glutSolidCone( 0.2, 0.2, 5, 1 );
     glPopMatrix();
 
-    glMaterialfv( GL_FRONT_AND_BACK, GL_AMBIENT, amDef );
-    glMaterialfv( GL_FRONT_AND_BACK, GL_SPECULAR, spDef );
-
     // Radius of influence
     if ( SHOW_FOV_RADIUS ) {
         glColor3f( 0.2, 0.2, 0.2 );
@@ -12,6 +12,7 @@
 #include "glm/vec3.hpp"
 #include "environment.hpp"
 #include "objReader.hpp"
+#include "renderQueue.hpp"
 #include <cmath>
 
 class Fish : public Renderable
@@ -27,8 +28,13 @@ class Fish : public Renderable
         bool update( float dt, uint32_t schoolID, std::vector< Fish > &school, glm::vec3 globalGoal,
                 Environment &e );
 
-        // Draw
+        // Draw, the texture and the material are set by the Flock
         void draw(int pass);
+        // ambient from the colour
+        RenderQueue::Material getMaterial() const;
+        GLuint getTexture() const;
+        // autour de m_pos, pour toutes les orientations
+        virtual bool getBoundingSphere(glm::vec3 &center, float &radius) const;
 
         // Draw Helpers
         void drawSeparation();
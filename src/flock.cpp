@@ -1,20 +1,52 @@
 #include "flock.hpp"
 #include "fish.hpp"
 #include "environment.hpp"
+#include "viewer.hpp"
 #include <iostream>
 #include "glm/geometric.hpp"
+#include <cfloat>
 
 
 void Flock::draw(int pass)
 {
     glPushAttrib(GL_CURRENT_BIT);
+    if (pass == PASS_NORMAL && !school.empty())
+        glBindTexture(GL_TEXTURE_2D, school[0].getTexture());
     for (std::vector<Fish>::iterator it(school.begin()); it != school.end(); ++it) {
+        if (pass == PASS_NORMAL)
+            it->getMaterial().apply();
         it->draw(pass);
     }
+    if (pass == PASS_NORMAL)
+        RenderQueue::Material().apply();
     glPopAttrib();
 }
 
-Flock::Flock(Environment &e, const std::string &fishModel) : step(0), env(e), dx(0), dy(0), model(fishModel)
+void Flock::submit(RenderQueue &queue, int pass)
+{
+    // visibility is tested once, the caustic pass reuses it
+    if (pass == PASS_NORMAL) {
+        visible.resize(school.size());
+        glm::vec3 center;
+        float radius;
+        for (uint32_t i = 0; i < school.size(); i++)
+            visible[i] = !school[i].getBoundingSphere(center, radius) || queue.isVisible(center, radius);
+    }
+    for (uint32_t i = 0; i < school.size(); i++) {
+        if (!visible[i])
+            continue;
+        queue.submit(this, i, pass, RENDER_OPAQUE, school[i].getTexture(),
+                school[i].getLeader() ? leaderMaterial : fishMaterial,
+                queue.depth(school[i].getPos()));
+    }
+}
+
+void Flock::drawItem(uint32_t fish, int pass)
+{
+    school[fish].draw(pass);
+}
+
+Flock::Flock(Environment &e, const std::string &fishModel) : step(0), env(e), leaderMaterial(0), fishMaterial(0), dx(0), dy(0), model(fishModel), terrain(NULL)
 {
 
 }
@@ -47,10 +79,43 @@ void Flock::animate()
         goal *= 0.95;  // Shrink potential goal area so goal is never "on the glass"
         if (goal.z < 0.1) goal.z = 0.1;
     }
+    keepAboveFloor();
     dx = 0;
     dy = 0;
 }
 
+void Flock::keepAboveFloor()
+{
+    if (!terrain)
+        return;
+    // une requête pour tout le banc, le but est le dernier point
+    const uint32_t n = school.size();
+    floorX.resize(n+1);
+    floorY.resize(n+1);
+    floorZ.resize(n+1);
+    for (uint32_t i = 0; i < n; i++) {
+        glm::vec3 p(school[i].getPos());
+        floorX[i] = p.x;
+        floorY[i] = p.y;
+        // pas de sol au dessus d'une tuile pas encore chargée
+        floorZ[i] = -FLT_MAX;
+    }
+    floorX[n] = goal.x;
+    floorY[n] = goal.y;
+    floorZ[n] = -FLT_MAX;
+    terrain->getZ(&floorX[0], &floorY[0], &floorZ[0], NULL, n+1);
+
+    for (uint32_t i = 0; i < n; i++) {
+        glm::vec3 p(school[i].getPos());
+        if (p.z < floorZ[i]+FLOOR_MARGIN) {
+            p.z = floorZ[i]+FLOOR_MARGIN;
+            school[i].setPos(p);
+        }
+    }
+    if (goal.z < floorZ[n]+FLOOR_MARGIN)
+        goal.z = floorZ[n]+FLOOR_MARGIN;
+}
+
 void Flock::init(Viewer& v)
 {
     // Make the flocking fish
@@ -73,4 +138,8 @@ void Flock::init(Viewer& v)
     school[0].setColour(glm::vec3( 1, 0.5, 0.5 ));
     school[0].setPos(glm::vec3( 0, 0, 0 ));
     goal = glm::vec3( 8, 5, 5 );    // Default Goal
+    terrain = v.tiles;
+    leaderMaterial = v.renderQueue.addMaterial(school[0].getMaterial());
+    if (school.size() > 1)
+        fishMaterial = v.renderQueue.addMaterial(school[1].getMaterial());
 }
@@ -12,9 +12,11 @@
 #define TIME_BETWEEN_UPDATES 3
 
 #define kSpeed 0.003f
+#define FLOOR_MARGIN 1.f // hauteur minimale des poissons au dessus du sol
 #include "renderable.hpp"
 #include "environment.hpp"
 #include "fish.hpp"
+#include "terrainTiles.hpp"
 #include "glm/vec3.hpp"
 #include <vector>
 
@@ -30,13 +32,25 @@ class Flock : public Renderable {
 
     /* Flocking Fish */
     std::vector<Fish> school;
+    /* Render queue materials of the leader and of the others */
+    uint32_t leaderMaterial, fishMaterial;
+    /* Fish in the camera frustum, updated by submit */
+    std::vector<bool> visible;
 
     int dx;
     int dy;
     std::string model;
 
+    /* Terrain following, over every loaded tile */
+    TerrainTiles *terrain;
+    std::vector<float> floorX, floorY, floorZ;
+    void keepAboveFloor();
+
     public:
     virtual void draw(int pass);
+    // one item per visible fish, sharing the texture of the model
+    virtual void submit(RenderQueue &queue, int pass);
+    virtual void drawItem(uint32_t fish, int pass);
     virtual void animate();
     virtual void init(Viewer& v);
 
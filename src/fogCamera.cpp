@@ -0,0 +1,14 @@
+#include "fogCamera.hpp"
+#include <algorithm>
+
+FogCamera::FogCamera(const qglviewer::Camera &c) : qglviewer::Camera(c), m_fogDistance(0.f)
+{
+}
+
+camera_real FogCamera::zFar() const
+{
+    camera_real z = qglviewer::Camera::zFar();
+    if (m_fogDistance <= 0.f)
+        return z;
+    return std::max(std::min(z, (camera_real)m_fogDistance), zNear());
+}
@@ -0,0 +1,36 @@
+#ifndef __FOG_CAMERA_H__
+#define __FOG_CAMERA_H__
+/*******************************************************************************
+ *  FogCamera                                                                  *
+ *  Sun Jun 08 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include <QGLViewer/qglviewer.h>
+
+// QGLViewer passe de float à qreal en 2.5
+#if defined(QGLVIEWER_VERSION) && QGLVIEWER_VERSION >= 0x020500
+typedef qreal camera_real;
+#else
+typedef float camera_real;
+#endif
+
+// Caméra dont le plan lointain s'arrête là où le brouillard a tout caché:
+// rien de ce qui est plus loin ne se voit, le frustum de la caméra le
+// rejette (cf RenderQueue::isVisible) et la précision du depth buffer est
+// meilleure.
+class FogCamera : public qglviewer::Camera {
+    float m_fogDistance; // 0 sans brouillard
+public:
+    FogCamera(const qglviewer::Camera &c);
+
+    inline void setFogDistance(float d) { m_fogDistance = d; }
+    inline float getFogDistance() const { return m_fogDistance; }
+
+    // le plus proche de celui de Camera et de la distance du brouillard
+    virtual camera_real zFar() const;
+};
+
+#endif
@@ -10,6 +10,10 @@
 
 #define TERRAIN_WIDTH 800.f
 #define TERRAIN_HEIGHT 800.f
+// sommets par côté de la grille du terrain, multiple de TERRAIN_CHUNK + 1
+#define TERRAIN_RES 257
+// terrain de départ déjà généré, cf NoiseTerrain::save
+#define TERRAIN_CACHE "terrain.cache"
 
 enum frame_type {
     e_armUL,
@@ -2,6 +2,7 @@
 using namespace std;
 #include "leg.hpp"
 #include "cylinder.hpp"
+#include "mesh.hpp"
 #include <cmath>
 
 
@@ -13,12 +14,17 @@ Leg::Leg(int prec) :
     }
 
 void Leg::draw(int pass)
+{
+    draw(pass, 0);
+}
+
+void Leg::draw(int pass, int level)
 {
     glPushMatrix();
-    glutSolidSphere(0.5, m_precision, m_precision);
+    Mesh::sphere(0.5, m_precision, m_precision, level).draw();
     glTranslatef(0, 0, 0.0);
     glRotatef(180, 0, 1, 0);
-    m_figure.draw(pass);
+    m_figure.draw(pass, level);
 
     glPopMatrix();
 }
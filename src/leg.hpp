@@ -13,6 +13,7 @@ class Leg : public Renderable
 {
     public:
         void draw(int pass);
+        void draw(int pass, int level);
         Leg(int prec);
         inline float getWidth() const { return m_width; }
         inline float getLength() const { return m_length; }
@@ -7,9 +7,35 @@
 #include "TextureManager.hpp"
 #include "glm/gtx/noise.hpp"
 #include "particlesystem.hpp"
+#include "bench.hpp"
+#include "profiler.hpp"
+#include <cstring>
+#include <cstdlib>
 
 int main(int argc, char** argv)
 {
+    // options à nous, avant celles de Qt
+    uint32_t crowdSize = 0;
+    float seekTime = 0.f;
+    const char *traceFile = NULL;
+    uint32_t traceFrames = PROFILE_DUMP_FRAMES;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bench")) {
+            if (i+1 < argc)
+                return Bench::run(argv[i+1]);
+            Bench::list();
+            return 1;
+        } else if (!strcmp(argv[i], "--crowd") && i+1 < argc) {
+            crowdSize = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seek") && i+1 < argc) {
+            seekTime = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--trace") && i+1 < argc) {
+            traceFile = argv[++i];
+        } else if (!strcmp(argv[i], "--trace-frames") && i+1 < argc) {
+            traceFrames = atoi(argv[++i]);
+        }
+    }
+
     // Read command lines arguments.
     QApplication application(argc,argv);
 #ifndef __APPLE__ // sur mac cet appel est en trop
@@ -18,8 +44,14 @@ int main(int argc, char** argv)
 
     // Instantiate the viewer.
     Viewer viewer;
+    viewer.crowdSize = crowdSize;
+    viewer.seekTime = seekTime;
+
+    //viewer.addRenderable(new ParticleSystem());
 
-    //viewer.addRenderable(new ParticleSystem(glm::vec3()));
+    // mesure dès le chargement, écrit les dernières images en quittant
+    if (traceFile)
+        Profiler::setEnabled(true);
 
     viewer.setWindowTitle("viewer");
     // Make the viewer window visible on screen.
@@ -31,5 +63,8 @@ int main(int argc, char** argv)
     //viewer.setSceneRadius(500.0f);
 
     // Run main loop.
-    return application.exec();
+    int ret = application.exec();
+    if (traceFile)
+        Profiler::dump(traceFile, traceFrames);
+    return ret;
 }
@@ -0,0 +1,248 @@
+#include "mesh.hpp"
+#include "glm/geometric.hpp"
+#include "glm/mat3x3.hpp"
+#include "glm/vec4.hpp"
+#include <cmath>
+#include <map>
+#include <algorithm>
+
+struct primitive_key_t {
+    Mesh::primitive_t kind;
+    int slices, stacks;
+    float a, b;
+    bool operator<(const primitive_key_t &o) const {
+        if (kind != o.kind) return kind < o.kind;
+        if (slices != o.slices) return slices < o.slices;
+        if (stacks != o.stacks) return stacks < o.stacks;
+        if (a != o.a) return a < o.a;
+        return b < o.b;
+    }
+};
+static std::map<primitive_key_t, Mesh*> s_primitives;
+
+Mesh& Mesh::primitive(primitive_t kind, int slices, int stacks, float a, float b, int level)
+{
+    primitive_key_t key;
+    key.kind = kind;
+    key.slices = std::max(3, slices>>level);
+    key.stacks = kind == e_cylinder ? 1 : std::max(2, stacks>>level);
+    key.a = a;
+    key.b = b;
+
+    std::map<primitive_key_t, Mesh*>::iterator it(s_primitives.find(key));
+    if (it != s_primitives.end())
+        return *it->second;
+
+    Mesh *mesh = new Mesh();
+    glm::mat4 id(1.f);
+    switch (kind) {
+        case e_cylinder:
+            mesh->addCylinder(id, a, b, key.slices);
+            break;
+        case e_sphere:
+            mesh->addSphere(id, a, key.slices, key.stacks);
+            break;
+        case e_cone:
+            mesh->addCone(id, a, b, key.slices, key.stacks);
+            break;
+    }
+    s_primitives[key] = mesh;
+    return *mesh;
+}
+
+int Mesh::levelOfDetail(float distance)
+{
+    int level = 0;
+    for (float l = MESH_LOD_DIST; distance > l && level < MESH_LOD_COUNT-1; l *= 2.f)
+        level++;
+    return level;
+}
+
+Mesh::Mesh() :
+    m_vbo(QGLBuffer::VertexBuffer), m_ibo(QGLBuffer::IndexBuffer),
+    m_uploaded(false), m_useVBO(false), m_nbVertices(0), m_nbIndices(0), m_radius(0.f)
+{}
+
+Mesh::~Mesh()
+{
+    if (m_vbo.isCreated())
+        m_vbo.destroy();
+    if (m_ibo.isCreated())
+        m_ibo.destroy();
+}
+
+GLuint Mesh::addVertex(const glm::mat4 &m, const glm::vec3 &p, const glm::vec3 &n, float s, float t)
+{
+    glm::vec4 tp(m*glm::vec4(p, 1.f));
+    glm::vec3 tn(glm::normalize(glm::mat3(m)*n));
+    GLfloat v[8] = { tp.x, tp.y, tp.z, tn.x, tn.y, tn.z, s, t };
+    m_vertices.insert(m_vertices.end(), v, v+8);
+    m_radius = std::max(m_radius, glm::length(glm::vec3(tp)));
+    return m_nbVertices++;
+}
+
+void Mesh::addCylinder(const glm::mat4 &m, float height, float width, int nbFaces)
+{
+    const float r = 0.5f*width;
+    // côtés: un quad par face, avec la normale de la face
+    for (int i = 0; i < nbFaces; i++) {
+        float a0 = i*2*M_PI/nbFaces, a1 = (i+1)*2*M_PI/nbFaces, am = (i+0.5)*2*M_PI/nbFaces;
+        glm::vec3 n(cos(am), sin(am), 0.f),
+                  p0(cos(a0)*r, sin(a0)*r, 0.f),
+                  p1(cos(a1)*r, sin(a1)*r, 0.f);
+        GLuint b0 = addVertex(m, p0, n, (float)i/nbFaces, 0.f),
+               t0 = addVertex(m, p0+glm::vec3(0.f, 0.f, height), n, (float)i/nbFaces, 1.f),
+               b1 = addVertex(m, p1, n, (float)(i+1)/nbFaces, 0.f),
+               t1 = addVertex(m, p1+glm::vec3(0.f, 0.f, height), n, (float)(i+1)/nbFaces, 1.f);
+        GLuint quad[6] = { b0, b1, t1, b0, t1, t0 };
+        m_indices.insert(m_indices.end(), quad, quad+6);
+    }
+    // couvercles en éventail
+    for (int c = 0; c < 2; c++) {
+        float z = c ? height : 0.f;
+        glm::vec3 n(0.f, 0.f, c ? 1.f : -1.f);
+        GLuint first = m_nbVertices;
+        for (int i = 0; i < nbFaces; i++) {
+            float a = i*2*M_PI/nbFaces;
+            addVertex(m, glm::vec3(cos(a)*r, sin(a)*r, z), n, (float)i/nbFaces, c ? 1.f : 0.f);
+        }
+        for (int i = 1; i < nbFaces-1; i++) {
+            // le dessous est vu de l'autre côté
+            GLuint tri[3] = { first, first+i+(c ? 0 : 1), first+i+(c ? 1 : 0) };
+            m_indices.insert(m_indices.end(), tri, tri+3);
+        }
+    }
+    m_nbIndices = m_indices.size();
+    m_uploaded = false;
+}
+
+void Mesh::addSphere(const glm::mat4 &m, float radius, int slices, int stacks)
+{
+    GLuint first = m_nbVertices;
+    for (int i = 0; i <= stacks; i++) {
+        float phi = i*M_PI/stacks; // depuis le pôle -z
+        for (int j = 0; j <= slices; j++) {
+            float theta = j*2*M_PI/slices;
+            glm::vec3 n(sin(phi)*cos(theta), sin(phi)*sin(theta), -cos(phi));
+            addVertex(m, n*radius, n, (float)j/slices, (float)i/stacks);
+        }
+    }
+    for (int i = 0; i < stacks; i++) {
+        for (int j = 0; j < slices; j++) {
+            GLuint a = first + i*(slices+1) + j, b = a+1,
+                   c = a+slices+1, d = c+1;
+            // pas de triangles dégénérés aux pôles
+            if (i > 0) {
+                GLuint tri[3] = { a, b, d };
+                m_indices.insert(m_indices.end(), tri, tri+3);
+            }
+            if (i < stacks-1) {
+                GLuint tri[3] = { a, d, c };
+                m_indices.insert(m_indices.end(), tri, tri+3);
+            }
+        }
+    }
+    m_nbIndices = m_indices.size();
+    m_uploaded = false;
+}
+
+void Mesh::addCone(const glm::mat4 &m, float base, float height, int slices, int stacks)
+{
+    // normale du côté, comme glutSolidCone
+    const float l = sqrt(height*height + base*base),
+                nz = base/l, nr = height/l;
+    GLuint first = m_nbVertices;
+    for (int i = 0; i <= stacks; i++) {
+        float z = i*height/stacks, r = base*(1.f-(float)i/stacks);
+        for (int j = 0; j <= slices; j++) {
+            float theta = j*2*M_PI/slices;
+            addVertex(m, glm::vec3(cos(theta)*r, sin(theta)*r, z),
+                    glm::vec3(cos(theta)*nr, sin(theta)*nr, nz), (float)j/slices, (float)i/stacks);
+        }
+    }
+    for (int i = 0; i < stacks; i++) {
+        for (int j = 0; j < slices; j++) {
+            GLuint a = first + i*(slices+1) + j, b = a+1,
+                   c = a+slices+1, d = c+1;
+            GLuint quad[6] = { a, b, d, a, d, c };
+            m_indices.insert(m_indices.end(), quad, quad+6);
+        }
+    }
+    // base
+    first = m_nbVertices;
+    for (int j = 0; j < slices; j++) {
+        float theta = j*2*M_PI/slices;
+        addVertex(m, glm::vec3(cos(theta)*base, sin(theta)*base, 0.f), glm::vec3(0.f, 0.f, -1.f),
+                0.5f+0.5f*cos(theta), 0.5f+0.5f*sin(theta));
+    }
+    for (int j = 1; j < slices-1; j++) {
+        GLuint tri[3] = { first, first+j+1, first+j };
+        m_indices.insert(m_indices.end(), tri, tri+3);
+    }
+    m_nbIndices = m_indices.size();
+    m_uploaded = false;
+}
+
+void Mesh::upload()
+{
+    // sans VBO on garde les tableaux côté client
+    if (!m_vbo.isCreated())
+        m_useVBO = m_vbo.create() && m_ibo.create();
+    if (m_useVBO) {
+        m_vbo.bind();
+        m_vbo.allocate(&m_vertices[0], m_vertices.size()*sizeof(GLfloat));
+        m_vbo.release();
+        m_ibo.bind();
+        m_ibo.allocate(&m_indices[0], m_indices.size()*sizeof(GLuint));
+        m_ibo.release();
+        std::vector<GLfloat>().swap(m_vertices);
+        std::vector<GLuint>().swap(m_indices);
+    }
+    m_uploaded = true;
+}
+
+void Mesh::bind()
+{
+    if (!m_uploaded && m_nbIndices > 0)
+        upload();
+
+    const GLsizei stride = 8*sizeof(GLfloat);
+    const GLfloat *v = NULL;
+    if (m_useVBO) {
+        m_vbo.bind();
+        m_ibo.bind();
+    } else if (!m_vertices.empty()) {
+        v = &m_vertices[0];
+    }
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, v);
+    glNormalPointer(GL_FLOAT, stride, v+3);
+    glTexCoordPointer(2, GL_FLOAT, stride, v+6);
+}
+
+void Mesh::drawElements() const
+{
+    if (m_nbIndices == 0)
+        return;
+    glDrawElements(GL_TRIANGLES, m_nbIndices, GL_UNSIGNED_INT, m_useVBO ? NULL : &m_indices[0]);
+}
+
+void Mesh::unbind()
+{
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    if (m_useVBO) {
+        QGLBuffer::release(QGLBuffer::VertexBuffer);
+        QGLBuffer::release(QGLBuffer::IndexBuffer);
+    }
+}
+
+void Mesh::draw()
+{
+    bind();
+    drawElements();
+    unbind();
+}
@@ -0,0 +1,91 @@
+#ifndef __MESH_H__
+#define __MESH_H__
+/*******************************************************************************
+ *  Mesh                                                                       *
+ *  Wed Jun 04 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#ifndef __APPLE__
+#include <GL/glut.h>
+#else
+#include <GLUT/glut.h>
+#endif
+#include <QGLBuffer>
+#include <vector>
+#include <stdint.h>
+#include "glm/vec3.hpp"
+#include "glm/mat4x4.hpp"
+
+#define MESH_LOD_COUNT 3 // niveaux de précision des primitives
+#define MESH_LOD_DIST 40.f // distance au delà de laquelle on passe au niveau 1
+
+// Géométrie statique en triangles, rangée dans un seul vertex buffer et un
+// seul index buffer. On peut y fusionner plusieurs primitives déjà placées,
+// elles sont alors dessinées en un seul appel.
+class Mesh {
+    std::vector<GLfloat> m_vertices; // x y z nx ny nz s t
+    std::vector<GLuint> m_indices;
+    QGLBuffer m_vbo, m_ibo;
+    bool m_uploaded, m_useVBO;
+    uint32_t m_nbVertices;
+    GLsizei m_nbIndices;
+    float m_radius; // distance du sommet le plus loin de l'origine
+
+    // ajoute un sommet transformé par m (n par la partie rotation de m)
+    GLuint addVertex(const glm::mat4 &m, const glm::vec3 &p, const glm::vec3 &n, float s, float t);
+    void upload();
+
+public:
+    enum primitive_t {
+        e_cylinder,
+        e_sphere,
+        e_cone
+    };
+
+    Mesh();
+    ~Mesh();
+
+    // Primitives partagées, tessellées une seule fois par (type, segments,
+    // dimensions). Au niveau level le nombre de segments est divisé par
+    // 2^level, pour les objets loins de la caméra.
+    static Mesh& primitive(primitive_t kind, int slices, int stacks, float a, float b, int level = 0);
+    static inline Mesh& cylinder(float height, float width, int nbFaces, int level = 0) {
+        return primitive(e_cylinder, nbFaces, 1, height, width, level);
+    }
+    // mêmes paramètres que glutSolidSphere et glutSolidCone
+    static inline Mesh& sphere(float radius, int slices, int stacks, int level = 0) {
+        return primitive(e_sphere, slices, stacks, radius, radius, level);
+    }
+    static inline Mesh& cone(float base, float height, int slices, int stacks, int level = 0) {
+        return primitive(e_cone, slices, stacks, base, height, level);
+    }
+    // niveau de précision pour un objet à distance de la caméra
+    static int levelOfDetail(float distance);
+
+    // Cylindre de la même forme que Cylinder: base en 0, hauteur selon z,
+    // nbFaces faces plates et deux couvercles
+    void addCylinder(const glm::mat4 &m, float height, float width, int nbFaces);
+    // centrée en 0, pôles selon z
+    void addSphere(const glm::mat4 &m, float radius, int slices, int stacks);
+    // base en 0, sommet en (0, 0, height)
+    void addCone(const glm::mat4 &m, float base, float height, int slices, int stacks);
+
+    // bind + drawElements + unbind, pour dessiner plusieurs fois le même
+    // mesh (avec des matrices différentes) on n'appelle bind qu'une fois
+    void draw();
+    void bind();
+    void drawElements() const;
+    void unbind();
+
+    inline uint32_t getNbVertices() const { return m_nbVertices; }
+    inline uint32_t getNbIndices() const { return m_nbIndices; }
+    // la sphère de ce rayon centrée à l'origine contient tous les sommets
+    inline float getRadius() const { return m_radius; }
+    // taille des buffers en octets
+    inline uint32_t getMemory() const { return m_nbVertices*8*sizeof(GLfloat) + m_nbIndices*sizeof(GLuint); }
+};
+
+#endif
@@ -6,12 +6,14 @@
 #include <sstream>
 #include <cmath>
 #include "TextureManager.hpp"
+#include "glm/common.hpp"
 #include <QGLViewer/qglviewer.h>
 
 objReader::objReader(const std::string &file, const char* texture)
-: m_vertices(), m_normals(), m_texCoord(), m_faces(), m_textures()
+: m_vertices(), m_normals(), m_texCoord(), m_faces(), m_textures(), m_radius(0.f)
 {
     loadObj(file);
+    computeBounds();
 
     //computeNormals();
 
@@ -24,9 +26,10 @@ objReader::objReader(const std::string &file, const char* texture)
         <<m_textures.size()<<" textures files were loaded\n";
 }
 
-objReader::objReader(const std::string &file, GLuint texture)
+objReader::objReader(const std::string &file, GLuint texture) : m_radius(0.f)
 {
     loadObj(file);
+    computeBounds();
 
     m_textures.push_back(texture);
 
@@ -111,19 +114,47 @@ objReader::~objReader()
     // all the containers are clared by default
 }
 
+// centre de la boîte englobante, rayon jusqu'au sommet le plus loin
+void objReader::computeBounds()
+{
+    if (m_vertices.empty())
+        return;
+    glm::vec3 lo(m_vertices[0]), hi(m_vertices[0]);
+    for (std::vector<glm::vec3>::const_iterator it(m_vertices.begin()); it != m_vertices.end(); ++it) {
+        lo = glm::min(lo, *it);
+        hi = glm::max(hi, *it);
+    }
+    m_center = 0.5f*(lo + hi);
+    m_radius = 0.f;
+    for (std::vector<glm::vec3>::const_iterator it(m_vertices.begin()); it != m_vertices.end(); ++it)
+        m_radius = std::max(m_radius, glm::length(*it - m_center));
+}
+
+bool objReader::getBoundingSphere(glm::vec3 &center, float &radius) const
+{
+    center = m_center;
+    radius = m_radius;
+    return !m_vertices.empty();
+}
+
 void objReader::computeNormals()
 {
     // not really needed
 }
 
 void objReader::draw(int pass) 
+{
+    if (m_textures.size() > 0 && pass == PASS_NORMAL)
+        glBindTexture(GL_TEXTURE_2D, m_textures[0]);
+    drawFaces();
+}
+
+void objReader::drawFaces()
 {
     glPushMatrix();
 
     //std::cout<<"DRAW\n";
     //glScalef(4.f, 4.f, 4.f);
-    if (m_textures.size() > 0 && pass == PASS_NORMAL)
-        glBindTexture(GL_TEXTURE_2D, m_textures[0]);
     for (std::vector<face>::iterator it(m_faces.begin()); it != m_faces.end(); ++it) {
         glBegin(GL_POLYGON);
         std::vector<int>::iterator nr(it->nr.begin());
@@ -11,6 +11,7 @@
 #include <vector>
 #include "glm/vec3.hpp"
 #include "glm/vec2.hpp"
+#include "glm/geometric.hpp"
 
 class objReader : public Renderable {
 
@@ -38,6 +39,10 @@ class objReader : public Renderable {
     std::vector<glm::vec2> m_texCoord;
     std::vector<face> m_faces;
     std::vector<GLuint> m_textures;
+    // sphère englobante dans le repère du modèle
+    glm::vec3 m_center;
+    float m_radius;
+    void computeBounds();
     //GLuint m_vertN, m_normN, m_texN;
 
     void computeNormals();
@@ -69,6 +74,15 @@ class objReader : public Renderable {
     ~objReader();
 
     virtual void draw(int pass);
+    // draw sans binder la texture
+    void drawFaces();
+    inline GLuint getTexture() const { return m_textures.empty() ? 0 : m_textures[0]; }
+
+    // dans le repère du modèle
+    virtual bool getBoundingSphere(glm::vec3 &center, float &radius) const;
+    // rayon de la sphère centrée sur l'origine du modèle qui le contient,
+    // elle ne change pas quand on le tourne
+    inline float getOriginRadius() const { return glm::length(m_center) + m_radius; }
 };
 
 #endif
@@ -0,0 +1,76 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+/*******************************************************************************
+ *  parallel                                                                   *
+ *  Tue Jun 03 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+#include <stdint.h>
+
+namespace parallel {
+
+template <class F>
+class RangeTask : public QRunnable {
+    const F &m_f;
+    uint32_t m_begin, m_end;
+    QSemaphore &m_done;
+public:
+    RangeTask(const F &f, uint32_t begin, uint32_t end, QSemaphore &done) :
+        m_f(f), m_begin(begin), m_end(end), m_done(done)
+    {}
+    void run()
+    {
+        m_f(m_begin, m_end);
+        m_done.release();
+    }
+};
+
+}
+
+// Découpe [0, n) en tranches d'au moins grain éléments et appelle
+// f(begin, end) pour chacune sur le pool global de Qt. Le thread appelant
+// traite aussi des tranches et ne rend la main que lorsque tout est fini.
+// Si le pool n'a plus de thread libre (appel depuis un thread du pool par
+// exemple) la tranche est faite sur place, on ne peut donc pas bloquer.
+// f doit pouvoir être appelé en même temps depuis plusieurs threads.
+template <class F>
+void parallelFor(uint32_t n, const F &f, uint32_t grain = 1024)
+{
+    QThreadPool *pool = QThreadPool::globalInstance();
+    uint32_t nbThreads = pool->maxThreadCount() + 1;
+    if (grain == 0)
+        grain = 1;
+    if (n <= grain || nbThreads <= 1) {
+        f(0, n);
+        return;
+    }
+
+    uint32_t nbTasks = (n + grain - 1)/grain;
+    if (nbTasks > nbThreads)
+        nbTasks = nbThreads;
+    uint32_t size = (n + nbTasks - 1)/nbTasks;
+
+    QSemaphore done;
+    int started = 0;
+    uint32_t begin = size; // la première tranche est pour l'appelant
+    for (; begin < n; begin += size) {
+        uint32_t end = begin + size < n ? begin + size : n;
+        parallel::RangeTask<F> *t = new parallel::RangeTask<F>(f, begin, end, done);
+        if (pool->tryStart(t)) {
+            started++;
+        } else {
+            delete t;
+            f(begin, end);
+        }
+    }
+    f(0, size < n ? size : n);
+    done.acquire(started);
+}
+
+#endif
@@ -5,6 +5,7 @@
 #endif
 
 #include "particle.hpp"
+#include "mesh.hpp"
 
 Particle::Particle(Vec pos, Vec vel, double m, double r)
 	: position(pos),
@@ -76,7 +77,8 @@ void Particle::draw(int pass) const
 	else
 		glColor3f(1,0,0);
 	glTranslatef(position.x, position.y, position.z);
-	glutSolidSphere(radius, 12, 12);
+	glScalef(radius, radius, radius);
+	Mesh::sphere(1.f, 12, 12).draw();
 	glPopMatrix();
 
 }
@@ -1,62 +1,178 @@
 #include "particlesystem.hpp"
-#include <ctime>
-#include <iterator>
-
-#define lifetimeMin 10
-#define lifetimeMax 60
-#define speedMin 1
-#define speedMax 10
-ParticleSystem::ParticleSystem(glm::vec3 pos) :
-    m_pos(pos),
-    m_timer(0)
-{
-    for (int i = 0; i < 10; i++) {
-        m_particles.push_back(new ParticleSystem::Particle(glm::vec3(0, 0, 0)));
-    }
+#include "glm/geometric.hpp"
+#include <cstdlib>
+#include <cmath>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+static inline float randomBetween(float a, float b)
+{
+    return a + (b - a)*(rand()/(float)RAND_MAX);
 }
 
-ParticleSystem::Particle::Particle(glm::vec3 pos) :
-    m_lifetime((random()%(lifetimeMax-lifetimeMin))+lifetimeMin),
-    m_pos(pos),
-    m_speed(glm::vec3(
-                (random()%(speedMax-speedMin))+speedMin,
-                (random()%(speedMax-speedMin))+speedMin,
-                (random()%(speedMax-speedMin))+speedMin)),
-    m_dSpeed(glm::vec3()),
-    m_rot(glm::vec3()),
-    m_dRot(glm::vec3()),
-    m_scale(1.0f),
-    m_dScale(0.0f),
-    m_friction(1.0f)
+ParticleSystem::Emitter::Emitter(const glm::vec3 &pos, const glm::vec3 &dir,
+        float cone, float rate, float speedMin, float speedMax, float lifeMin, float lifeMax) :
+    position(pos), direction(dir), cone(cone), rate(rate),
+    speedMin(speedMin), speedMax(speedMax), lifeMin(lifeMin), lifeMax(lifeMax)
 {
 }
 
-void ParticleSystem::draw(int pass)
+ParticleSystem::ParticleSystem(uint32_t capacity, float dt) :
+    m_capacity(capacity), m_count(0),
+    m_px(capacity), m_py(capacity), m_pz(capacity),
+    m_vx(capacity), m_vy(capacity), m_vz(capacity),
+    m_age(capacity), m_life(capacity),
+    m_vertices(capacity*7),
+    m_dt(dt), m_drag(PARTICLES_DRAG), m_buoyancy(PARTICLES_BUOYANCY),
+    m_simd(true), m_color(0.8f, 0.9f, 1.f)
 {
-    glPushMatrix();
-    glTranslatef(m_pos.x, m_pos.y, m_pos.z);
-    for (std::list<Particle *>::iterator it(m_particles.begin()); it != m_particles.end(); it++) {
-        glColor3f(1,0,0);
-        glPushMatrix();
-        glTranslatef((*it)->m_pos.x,(*it)->m_pos.y,(*it)->m_pos.z);
-        glutSolidSphere(1, 8, 5);
-        glPopMatrix();
+}
+
+ParticleSystem::~ParticleSystem()
+{
+}
+
+uint32_t ParticleSystem::addEmitter(const Emitter &e)
+{
+    m_emitters.push_back(e);
+    m_pending.push_back(0.f);
+    return m_emitters.size()-1;
+}
+
+void ParticleSystem::emit(const Emitter &e)
+{
+    if (m_count == m_capacity)
+        return;
+    // direction uniforme dans le cône: cos(theta) uniforme dans [cos(cone), 1]
+    glm::vec3 w(glm::normalize(e.direction)),
+              t(fabs(w.x) < 0.9f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f)),
+              u(glm::normalize(glm::cross(w, t))),
+              v(glm::cross(w, u));
+    float cosTheta = randomBetween(cos(e.cone*M_PI/180.f), 1.f),
+          sinTheta = sqrt(1.f - cosTheta*cosTheta),
+          phi = randomBetween(0.f, 2.f*M_PI);
+    glm::vec3 dir(u*(sinTheta*cosf(phi)) + v*(sinTheta*sinf(phi)) + w*cosTheta);
+    glm::vec3 vel(dir*randomBetween(e.speedMin, e.speedMax));
+
+    uint32_t i = m_count++;
+    m_px[i] = e.position.x;
+    m_py[i] = e.position.y;
+    m_pz[i] = e.position.z;
+    m_vx[i] = vel.x;
+    m_vy[i] = vel.y;
+    m_vz[i] = vel.z;
+    m_age[i] = 0.f;
+    m_life[i] = randomBetween(e.lifeMin, e.lifeMax);
+}
+
+// v += (poussée - traînée*v)*dt, p += v*dt, âge += dt
+void ParticleSystem::integrate(uint32_t begin, uint32_t end)
+{
+    const float damp = 1.f - m_drag*m_dt, lift = m_buoyancy*m_dt;
+    for (uint32_t i = begin; i < end; i++) {
+        m_vx[i] *= damp;
+        m_vy[i] *= damp;
+        m_vz[i] = m_vz[i]*damp + lift;
+        m_px[i] += m_vx[i]*m_dt;
+        m_py[i] += m_vy[i]*m_dt;
+        m_pz[i] += m_vz[i]*m_dt;
+        m_age[i] += m_dt;
     }
+}
 
-    glPopMatrix();
+#ifdef __SSE__
+// même calcul que integrate sur [0, end[, end multiple de 4
+void ParticleSystem::integrateSSE(uint32_t end)
+{
+    const __m128 damp = _mm_set1_ps(1.f - m_drag*m_dt),
+          lift = _mm_set1_ps(m_buoyancy*m_dt),
+          dt = _mm_set1_ps(m_dt);
+    for (uint32_t i = 0; i < end; i += 4) {
+        __m128 vx = _mm_mul_ps(_mm_loadu_ps(&m_vx[i]), damp),
+               vy = _mm_mul_ps(_mm_loadu_ps(&m_vy[i]), damp),
+               vz = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m_vz[i]), damp), lift);
+        _mm_storeu_ps(&m_vx[i], vx);
+        _mm_storeu_ps(&m_vy[i], vy);
+        _mm_storeu_ps(&m_vz[i], vz);
+        _mm_storeu_ps(&m_px[i], _mm_add_ps(_mm_loadu_ps(&m_px[i]), _mm_mul_ps(vx, dt)));
+        _mm_storeu_ps(&m_py[i], _mm_add_ps(_mm_loadu_ps(&m_py[i]), _mm_mul_ps(vy, dt)));
+        _mm_storeu_ps(&m_pz[i], _mm_add_ps(_mm_loadu_ps(&m_pz[i]), _mm_mul_ps(vz, dt)));
+        _mm_storeu_ps(&m_age[i], _mm_add_ps(_mm_loadu_ps(&m_age[i]), dt));
+    }
 }
+#endif
 
-void ParticleSystem::animate()
+// les particules mortes sont remplacées par la dernière vivante
+void ParticleSystem::recycle()
 {
-    m_timer++;
-    for (std::list<Particle *>::iterator it(m_particles.begin()); it != m_particles.end(); it++) {
-        if (m_timer > (*it)->m_lifetime) {
-            //delete (*it);
+    uint32_t i = 0;
+    while (i < m_count) {
+        if (m_age[i] < m_life[i]) {
+            i++;
+            continue;
         }
-        (*it)->m_pos += (*it)->m_speed;
+        uint32_t last = --m_count;
+        m_px[i] = m_px[last];
+        m_py[i] = m_py[last];
+        m_pz[i] = m_pz[last];
+        m_vx[i] = m_vx[last];
+        m_vy[i] = m_vy[last];
+        m_vz[i] = m_vz[last];
+        m_age[i] = m_age[last];
+        m_life[i] = m_life[last];
     }
 }
 
-ParticleSystem::~ParticleSystem()
+void ParticleSystem::animate()
+{
+    uint32_t done = 0;
+#ifdef __SSE__
+    if (m_simd) {
+        done = m_count & ~3u;
+        integrateSSE(done);
+    }
+#endif
+    integrate(done, m_count);
+    recycle();
+
+    for (uint32_t e = 0; e < m_emitters.size(); e++) {
+        m_pending[e] += m_emitters[e].rate*m_dt;
+        for (; m_pending[e] >= 1.f; m_pending[e] -= 1.f)
+            emit(m_emitters[e]);
+    }
+}
+
+void ParticleSystem::draw(int pass)
 {
+    if (m_count == 0)
+        return;
+    // s'efface en fin de vie
+    for (uint32_t i = 0; i < m_count; i++) {
+        GLfloat *v = &m_vertices[i*7];
+        v[0] = m_px[i];
+        v[1] = m_py[i];
+        v[2] = m_pz[i];
+        v[3] = m_color.x;
+        v[4] = m_color.y;
+        v[5] = m_color.z;
+        v[6] = 1.f - m_age[i]/m_life[i];
+    }
+
+    if (pass == PASS_NORMAL)
+        glBindTexture(GL_TEXTURE_2D, 0);
+    glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT | GL_POINT_BIT);
+    glDisable(GL_LIGHTING);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glPointSize(3.f);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 7*sizeof(GLfloat), &m_vertices[0]);
+    glColorPointer(4, GL_FLOAT, 7*sizeof(GLfloat), &m_vertices[3]);
+    glDrawArrays(GL_POINTS, 0, m_count);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glPopAttrib();
 }
@@ -6,36 +6,81 @@
 #else
 #include <GLUT/glut.h>
 #endif
-#include <list>
 #include <vector>
+#include <stdint.h>
 #include "renderable.hpp"
 #include "glm/vec3.hpp"
 
+#define PARTICLES_CAPACITY 4096
+#define PARTICLES_DRAG 0.5f // fraction de la vitesse perdue par seconde
+#define PARTICLES_BUOYANCY 2.f // poussée vers le haut, en unités/s²
+
+// Particules de capacité fixe: tous les tableaux sont alloués à la
+// construction et les particules vivantes sont tassées dans [0, count[,
+// une particule morte est remplacée par la dernière. Aucun new ni
+// delete pendant l'animation.
+// L'intégration (traînée, poussée, vitesse) est faite 4 particules à la
+// fois en SSE quand le compilateur le permet, la version scalaire reste
+// disponible.
 class ParticleSystem : public Renderable
 {
     public:
-        ParticleSystem(glm::vec3 pos);
+        // Émet rate particules par seconde depuis position, dans un cône
+        // de demi-angle cone (degrés) autour de direction
+        struct Emitter {
+            glm::vec3 position, direction;
+            float cone, rate,
+                  speedMin, speedMax,
+                  lifeMin, lifeMax; // secondes
+            Emitter(const glm::vec3 &pos = glm::vec3(), const glm::vec3 &dir = glm::vec3(0.f, 0.f, 1.f),
+                    float cone = 15.f, float rate = 30.f,
+                    float speedMin = 1.f, float speedMax = 3.f,
+                    float lifeMin = 1.f, float lifeMax = 3.f);
+        };
+
+        ParticleSystem(uint32_t capacity = PARTICLES_CAPACITY, float dt = 1.f/30.f);
         ~ParticleSystem();
 
+        // renvoie l'indice de l'émetteur
+        uint32_t addEmitter(const Emitter &e);
+        inline Emitter& getEmitter(uint32_t i) { return m_emitters[i]; }
+
+        inline void setDrag(float d) { m_drag = d; }
+        inline void setBuoyancy(float b) { m_buoyancy = b; }
+        inline void setSIMD(bool onOff) { m_simd = onOff; }
+        inline void setColor(const glm::vec3 &c) { m_color = c; }
+
+        inline uint32_t getCount() const { return m_count; }
+        inline uint32_t getCapacity() const { return m_capacity; }
+        inline bool hasSIMD() const {
+#ifdef __SSE__
+            return true;
+#else
+            return false;
+#endif
+        }
+
     private:
-        class Particle
-        {
-            public:
-                Particle(glm::vec3 pos);
-                int m_lifetime;
-                glm::vec3 m_pos,
-                    m_speed,
-                    m_dSpeed,
-                    m_rot,
-                    m_dRot;
-                float m_scale,
-                      m_dScale,
-                      m_friction;
-        };
+        uint32_t m_capacity, m_count;
+        // SoA: particule i = (m_px[i], m_py[i], m_pz[i], ...)
+        std::vector<float> m_px, m_py, m_pz,
+            m_vx, m_vy, m_vz,
+            m_age, m_life;
+        std::vector<GLfloat> m_vertices; // x y z r g b a pour draw
+        std::vector<Emitter> m_emitters;
+        std::vector<float> m_pending; // fractions de particule à émettre
+
+        float m_dt, m_drag, m_buoyancy;
+        bool m_simd;
+        glm::vec3 m_color;
+
+        void emit(const Emitter &e);
+        void integrate(uint32_t begin, uint32_t end);
+#ifdef __SSE__
+        void integrateSSE(uint32_t end);
+#endif
+        void recycle();
 
-        glm::vec3 m_pos;
-        std::list<Particle *> m_particles;
-        int m_timer;
         //Renderable methods
     public:
         void draw(int pass);
@@ -0,0 +1,296 @@
+#include "pbdSystem.hpp"
+#include "parallel.hpp"
+#include "glm/geometric.hpp"
+#include <cmath>
+#include <algorithm>
+
+// prédiction des particules [begin, end)
+struct PBDPredictTask {
+    PBDSystem &sys;
+    PBDPredictTask(PBDSystem &s) : sys(s) {}
+
+    void operator()(uint32_t begin, uint32_t end) const
+    {
+        const glm::vec3 dv(sys.m_acceleration*sys.m_dt);
+        for (uint32_t i = begin; i < end; i++) {
+            if (sys.m_invMasses[i] > 0.f)
+                sys.m_velocities[i] += dv;
+            sys.m_predicted[i] = sys.m_positions[i] + sys.m_velocities[i]*sys.m_dt;
+        }
+    }
+};
+
+// projection des contraintes [first+begin, first+end) d'une même couleur
+struct PBDSolveTask {
+    PBDSystem &sys;
+    uint32_t first;
+    PBDSolveTask(PBDSystem &s, uint32_t f) : sys(s), first(f) {}
+
+    void operator()(uint32_t begin, uint32_t end) const
+    {
+        for (uint32_t c = first+begin; c < first+end; c++) {
+            uint32_t a = sys.m_a[c], b = sys.m_b[c];
+            float wa = sys.m_invMasses[a], wb = sys.m_invMasses[b],
+                  w = wa + wb;
+            if (w == 0.f)
+                continue;
+            glm::vec3 d(sys.m_predicted[a] - sys.m_predicted[b]);
+            float l = glm::length(d);
+            if (l < 1e-6f)
+                continue;
+            glm::vec3 corr(d*(sys.m_effective[c]*(l - sys.m_restLengths[c])/(l*w)));
+            sys.m_predicted[a] -= wa*corr;
+            sys.m_predicted[b] += wb*corr;
+        }
+    }
+};
+
+// nouvelles vitesses et positions des particules [begin, end)
+struct PBDVelocityTask {
+    PBDSystem &sys;
+    PBDVelocityTask(PBDSystem &s) : sys(s) {}
+
+    void operator()(uint32_t begin, uint32_t end) const
+    {
+        const float k = (1.f - PBD_DAMPING)/sys.m_dt;
+        for (uint32_t i = begin; i < end; i++) {
+            sys.m_velocities[i] = (sys.m_predicted[i] - sys.m_positions[i])*k;
+            sys.m_positions[i] = sys.m_predicted[i];
+        }
+    }
+};
+
+PBDSystem::PBDSystem(float dt) :
+    m_colored(true), m_effectiveValid(true),
+    m_color(1.f, 1.f, 1.f), m_dt(dt), m_iterations(PBD_ITERATIONS)
+{
+    m_colors.push_back(0);
+}
+
+uint32_t PBDSystem::addParticle(const glm::vec3 &pos, float invMass)
+{
+    m_positions.push_back(pos);
+    m_predicted.push_back(pos);
+    m_velocities.push_back(glm::vec3());
+    m_normals.push_back(glm::vec3(0.f, 0.f, 1.f));
+    m_invMasses.push_back(invMass);
+    return m_positions.size()-1;
+}
+
+void PBDSystem::addDistance(uint32_t a, uint32_t b, float stiffness)
+{
+    m_a.push_back(a);
+    m_b.push_back(b);
+    m_restLengths.push_back(glm::length(m_positions[a] - m_positions[b]));
+    m_stiffness.push_back(stiffness);
+    m_colored = false;
+    m_effectiveValid = false;
+}
+
+void PBDSystem::addLine(uint32_t a, uint32_t b)
+{
+    m_lines.push_back(a);
+    m_lines.push_back(b);
+}
+
+void PBDSystem::addTriangle(uint32_t a, uint32_t b, uint32_t c)
+{
+    m_triangles.push_back(a);
+    m_triangles.push_back(b);
+    m_triangles.push_back(c);
+}
+
+uint32_t PBDSystem::addRope(const glm::vec3 &from, const glm::vec3 &to, uint32_t n,
+        float stiffness, float bending)
+{
+    uint32_t first = m_positions.size();
+    for (uint32_t i = 0; i < n; i++)
+        addParticle(from + (to - from)*(n > 1 ? (float)i/(n-1) : 0.f), i == 0 ? 0.f : 1.f);
+    for (uint32_t i = first; i+1 < first+n; i++) {
+        addDistance(i, i+1, stiffness);
+        addLine(i, i+1);
+        if (i+2 < first+n)
+            addDistance(i, i+2, bending);
+    }
+    return first;
+}
+
+uint32_t PBDSystem::addCloth(const glm::vec3 &origin, const glm::vec3 &u, const glm::vec3 &v,
+        uint32_t nu, uint32_t nv, float stretch, float bending)
+{
+    uint32_t first = m_positions.size();
+    for (uint32_t j = 0; j < nv; j++) {
+        for (uint32_t i = 0; i < nu; i++)
+            addParticle(origin + u*(nu > 1 ? (float)i/(nu-1) : 0.f) + v*(nv > 1 ? (float)j/(nv-1) : 0.f),
+                    i == 0 ? 0.f : 1.f);
+    }
+    for (uint32_t j = 0; j < nv; j++) {
+        for (uint32_t i = 0; i < nu; i++) {
+            uint32_t p = first + j*nu + i;
+            if (i+1 < nu)
+                addDistance(p, p+1, stretch);
+            if (j+1 < nv)
+                addDistance(p, p+nu, stretch);
+            if (i+1 < nu && j+1 < nv) {
+                addDistance(p, p+nu+1, stretch);
+                addDistance(p+1, p+nu, stretch);
+                addTriangle(p, p+1, p+nu+1);
+                addTriangle(p, p+nu+1, p+nu);
+            }
+            if (i+2 < nu)
+                addDistance(p, p+2, bending);
+            if (j+2 < nv)
+                addDistance(p, p+2*nu, bending);
+        }
+    }
+    return first;
+}
+
+void PBDSystem::setIterations(uint32_t n)
+{
+    m_iterations = n > 0 ? n : 1;
+    m_effectiveValid = false;
+}
+
+void PBDSystem::setAcceleration(const glm::vec3 &a)
+{
+    m_acceleration = a;
+}
+
+void PBDSystem::setColor(const glm::vec3 &c)
+{
+    m_color = c;
+}
+
+void PBDSystem::setPosition(uint32_t i, const glm::vec3 &p)
+{
+    m_positions[i] = p;
+    m_predicted[i] = p;
+}
+
+void PBDSystem::colorize()
+{
+    if (m_colored)
+        return;
+    const uint32_t n = m_a.size();
+    std::vector<uint64_t> used(m_positions.size(), 0);
+    std::vector<uint32_t> color(n);
+    std::vector<uint32_t> count(PBD_MAX_COLORS+1, 0);
+    uint32_t nbColors = 0;
+    for (uint32_t c = 0; c < n; c++) {
+        uint64_t taken = used[m_a[c]] | used[m_b[c]];
+        uint32_t k = 0;
+        while (k < PBD_MAX_COLORS && (taken & ((uint64_t)1 << k)))
+            k++;
+        if (k < PBD_MAX_COLORS) {
+            used[m_a[c]] |= (uint64_t)1 << k;
+            used[m_b[c]] |= (uint64_t)1 << k;
+        }
+        color[c] = k;
+        count[k]++;
+        if (k+1 > nbColors)
+            nbColors = k+1;
+    }
+
+    m_colors.assign(nbColors+1, 0);
+    for (uint32_t k = 0; k < nbColors; k++)
+        m_colors[k+1] = m_colors[k] + count[k];
+
+    // tri par couleur, stable pour garder l'ordre de création
+    std::vector<uint32_t> next(m_colors.begin(), m_colors.end()-1);
+    std::vector<uint32_t> a(n), b(n);
+    std::vector<float> rest(n), stiffness(n);
+    for (uint32_t c = 0; c < n; c++) {
+        uint32_t dst = next[color[c]]++;
+        a[dst] = m_a[c];
+        b[dst] = m_b[c];
+        rest[dst] = m_restLengths[c];
+        stiffness[dst] = m_stiffness[c];
+    }
+    m_a.swap(a);
+    m_b.swap(b);
+    m_restLengths.swap(rest);
+    m_stiffness.swap(stiffness);
+    m_colored = true;
+    m_effectiveValid = false;
+}
+
+void PBDSystem::update(uint32_t grain)
+{
+    colorize();
+    if (!m_effectiveValid) {
+        m_effective.resize(m_stiffness.size());
+        for (uint32_t c = 0; c < m_stiffness.size(); c++)
+            m_effective[c] = 1.f - pow(1.f - m_stiffness[c], 1.f/m_iterations);
+        m_effectiveValid = true;
+    }
+
+    const uint32_t n = m_positions.size();
+    // quelques centaines de contraintes par couleur: répartir chacune des
+    // ~100 couleurs x itérations coûte plus que de les résoudre
+    if (m_a.size() < PBD_SERIAL)
+        grain = std::max(grain, std::max(n, (uint32_t)m_a.size()));
+    parallelFor(n, PBDPredictTask(*this), grain);
+    for (uint32_t it = 0; it < m_iterations; it++) {
+        for (uint32_t k = 0; k+1 < m_colors.size(); k++) {
+            uint32_t size = m_colors[k+1] - m_colors[k];
+            // la dernière couleur peut contenir des contraintes liées
+            bool shared = k == PBD_MAX_COLORS;
+            parallelFor(size, PBDSolveTask(*this, m_colors[k]), shared ? size : grain);
+        }
+    }
+    parallelFor(n, PBDVelocityTask(*this), grain);
+}
+
+void PBDSystem::animate()
+{
+    update();
+}
+
+void PBDSystem::computeNormals()
+{
+    for (uint32_t i = 0; i < m_normals.size(); i++)
+        m_normals[i] = glm::vec3();
+    for (uint32_t t = 0; t < m_triangles.size(); t += 3) {
+        const glm::vec3 &p0 = m_positions[m_triangles[t]],
+              &p1 = m_positions[m_triangles[t+1]],
+              &p2 = m_positions[m_triangles[t+2]];
+        glm::vec3 n(glm::cross(p1 - p0, p2 - p0));
+        m_normals[m_triangles[t]] += n;
+        m_normals[m_triangles[t+1]] += n;
+        m_normals[m_triangles[t+2]] += n;
+    }
+    for (uint32_t i = 0; i < m_normals.size(); i++) {
+        float l = glm::length(m_normals[i]);
+        if (l > 0.f)
+            m_normals[i] /= l;
+    }
+}
+
+void PBDSystem::draw(int pass)
+{
+    if (m_positions.empty())
+        return;
+    if (pass == PASS_NORMAL)
+        glBindTexture(GL_TEXTURE_2D, 0);
+    glColor3f(m_color.x, m_color.y, m_color.z);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, &m_positions[0]);
+    if (!m_triangles.empty()) {
+        computeNormals();
+        // un tissu se voit des deux côtés
+        glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glNormalPointer(GL_FLOAT, 0, &m_normals[0]);
+        glDrawElements(GL_TRIANGLES, m_triangles.size(), GL_UNSIGNED_INT, &m_triangles[0]);
+        glDisableClientState(GL_NORMAL_ARRAY);
+        glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_FALSE);
+    }
+    if (!m_lines.empty()) {
+        glLineWidth(3.f);
+        glDrawElements(GL_LINES, m_lines.size(), GL_UNSIGNED_INT, &m_lines[0]);
+        glLineWidth(1.f);
+    }
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
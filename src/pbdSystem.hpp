@@ -0,0 +1,111 @@
+#ifndef __PBD_SYSTEM_H__
+#define __PBD_SYSTEM_H__
+/*******************************************************************************
+ *  PBDSystem                                                                  *
+ *  Fri Jun 06 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include "renderable.hpp"
+#ifndef __APPLE__
+#include <GL/glut.h>
+#else
+#include <GLUT/glut.h>
+#endif
+#include <vector>
+#include <stdint.h>
+#include "glm/vec3.hpp"
+
+#define PBD_ITERATIONS 8
+#define PBD_DAMPING 0.02f // fraction de la vitesse perdue à chaque pas
+#define PBD_GRAIN 512 // contraintes par tranche pour les threads
+#define PBD_SERIAL 4096 // en dessous de ce nombre de contraintes tout le pas reste sur le thread appelant
+#define PBD_MAX_COLORS 64 // au delà les contraintes restantes sont résolues sur un seul thread
+
+// Cordes, câbles et tissus en position based dynamics (Müller et al.): on
+// prédit les positions puis on projette les contraintes de distance
+// plusieurs fois par pas, la vitesse est déduite du déplacement.
+// Les contraintes sont rangées en tableaux plats et triées par couleur:
+// deux contraintes d'une même couleur ne partagent aucune particule, chaque
+// couleur est donc résolue en Gauss-Seidel sur tous les threads à la fois.
+// Une contrainte de courbure est une distance entre deux particules
+// séparées par une troisième, avec une raideur plus faible.
+class PBDSystem : public Renderable {
+    friend struct PBDPredictTask;
+    friend struct PBDSolveTask;
+    friend struct PBDVelocityTask;
+
+    // particules
+    std::vector<glm::vec3> m_positions, m_predicted, m_velocities, m_normals;
+    std::vector<float> m_invMasses; // 0 pour une particule fixe
+
+    // contraintes, triées par couleur après colorize()
+    std::vector<uint32_t> m_a, m_b;
+    std::vector<float> m_restLengths;
+    std::vector<float> m_stiffness; // dans [0, 1], pour tout le pas
+    std::vector<float> m_effective; // pour une itération
+    std::vector<uint32_t> m_colors; // début de chaque couleur, plus la fin
+    bool m_colored, m_effectiveValid;
+
+    // affichage
+    std::vector<uint32_t> m_lines;
+    std::vector<uint32_t> m_triangles;
+    glm::vec3 m_color;
+
+    glm::vec3 m_acceleration;
+    float m_dt;
+    uint32_t m_iterations;
+
+    // coloration gloutonne: chaque contrainte prend la première couleur
+    // qu'aucune de ses particules n'utilise encore
+    void colorize();
+    void computeNormals();
+
+public:
+    PBDSystem(float dt = 1.f/30.f);
+
+    uint32_t addParticle(const glm::vec3 &pos, float invMass);
+    // longueur au repos: la distance actuelle entre a et b
+    void addDistance(uint32_t a, uint32_t b, float stiffness);
+    void addLine(uint32_t a, uint32_t b);
+    void addTriangle(uint32_t a, uint32_t b, uint32_t c);
+
+    // n particules de from à to, la première fixe, renvoie l'indice de la
+    // première. Avec n < 2 seule la particule fixe en from est ajoutée.
+    uint32_t addRope(const glm::vec3 &from, const glm::vec3 &to, uint32_t n,
+            float stiffness, float bending);
+    // nu*nv particules en origin + i/(nu-1)*u + j/(nv-1)*v, la colonne i = 0
+    // est fixe (le mât d'un drapeau). Ressorts de structure et de
+    // cisaillement de raideur stretch, courbure de raideur bending. Avec
+    // nu ou nv < 2 les particules sont sur origin selon cette direction.
+    uint32_t addCloth(const glm::vec3 &origin, const glm::vec3 &u, const glm::vec3 &v,
+            uint32_t nu, uint32_t nv, float stretch, float bending);
+
+    // Le nombre d'itérations et la raideur sont indépendants: la raideur
+    // par itération est corrigée en 1-(1-k)^(1/n) pour que k garde le même
+    // effet quel que soit n. Plus d'itérations rapprochent seulement les
+    // contraintes de k = 1 de l'inextensible.
+    void setIterations(uint32_t n);
+    void setAcceleration(const glm::vec3 &a);
+    void setColor(const glm::vec3 &c);
+    // déplace une particule, fixe en général (point d'accroche)
+    void setPosition(uint32_t i, const glm::vec3 &p);
+
+    // un pas de temps, par tranches de grain contraintes, sur le seul
+    // thread appelant pour un petit système (cf PBD_SERIAL)
+    void update(uint32_t grain = PBD_GRAIN);
+    void animate();
+    void draw(int pass);
+
+    inline uint32_t getNbParticles() const { return m_positions.size(); }
+    inline uint32_t getNbConstraints() const { return m_a.size(); }
+    inline uint32_t getNbColors() { colorize(); return m_colors.size()-1; }
+    inline const glm::vec3 &getPosition(uint32_t i) const { return m_positions[i]; }
+    inline float getRestLength(uint32_t c) const { return m_restLengths[c]; }
+    inline uint32_t getA(uint32_t c) const { return m_a[c]; }
+    inline uint32_t getB(uint32_t c) const { return m_b[c]; }
+};
+
+#endif
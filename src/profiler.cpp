@@ -0,0 +1,166 @@
+#include "profiler.hpp"
+#include <QElapsedTimer>
+#include <QThreadStorage>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+QAtomicInt Profiler::s_enabled(0);
+QAtomicPointer<Profiler::Ring> Profiler::s_rings[PROFILE_MAX_THREADS];
+QAtomicInt Profiler::s_nbRings(0);
+int64_t Profiler::s_frames[PROFILE_MAX_FRAMES];
+uint32_t Profiler::s_nbFrames = 0;
+
+static QElapsedTimer startedClock()
+{
+    QElapsedTimer t;
+    t.start();
+    return t;
+}
+// démarrée au chargement, avant tout thread: nsecsElapsed ne fait que
+// lire l'horloge
+static const QElapsedTimer s_clock = startedClock();
+// indice + 1 de l'anneau du thread dans s_rings, -1 s'il n'y en a plus
+static QThreadStorage<int> s_ringIndex;
+
+int64_t Profiler::now()
+{
+    return s_clock.nsecsElapsed();
+}
+
+void Profiler::setEnabled(bool onOff)
+{
+    // le thread qui active est le premier anneau
+    if (onOff)
+        ring();
+    s_enabled.fetchAndStoreRelease(onOff ? 1 : 0);
+}
+
+void Profiler::newFrame()
+{
+    if (!s_enabled)
+        return;
+    s_frames[s_nbFrames % PROFILE_MAX_FRAMES] = now();
+    s_nbFrames++;
+}
+
+// les anneaux ne sont jamais libérés: un thread du pool qui se termine
+// laisse ses événements pour le dump
+Profiler::Ring *Profiler::ring()
+{
+    int index = s_ringIndex.localData();
+    if (index == 0) {
+        int i = s_nbRings.fetchAndAddOrdered(1);
+        if (i < PROFILE_MAX_THREADS) {
+            s_rings[i].fetchAndStoreRelease(new Ring());
+            index = i + 1;
+        } else {
+            index = -1;
+        }
+        s_ringIndex.setLocalData(index);
+    }
+    // notre propre anneau: pas besoin de barrière pour le relire
+    return index > 0 ? (Ring*)s_rings[index-1] : NULL;
+}
+
+void Profiler::Scope::begin(const char *name)
+{
+    m_name = name;
+    m_begin = now();
+}
+
+void Profiler::Scope::end()
+{
+    Ring *r = ring();
+    if (!r)
+        return;
+    int n = r->count;
+    Event &e = r->events[n & (PROFILE_RING_SIZE-1)];
+    e.name = m_name;
+    e.begin = m_begin;
+    e.end = now();
+    r->count.fetchAndAddRelease(1);
+}
+
+// les noms de typeid sont décodés, les autres écrits tels quels
+static std::string eventName(const char *name)
+{
+    std::string s(name);
+#ifdef __GNUG__
+    if (isdigit(name[0])) {
+        int status = 0;
+        char *d = abi::__cxa_demangle(name, NULL, NULL, &status);
+        if (status == 0 && d)
+            s = d;
+        free(d);
+    }
+#endif
+    // rien à échapper dans nos noms sauf d'éventuels guillemets
+    std::string escaped;
+    for (uint32_t i = 0; i < s.size(); i++) {
+        if (s[i] == '"' || s[i] == '\\')
+            escaped += '\\';
+        escaped += s[i];
+    }
+    return escaped;
+}
+
+bool Profiler::dump(const std::string &file, uint32_t frames)
+{
+    std::ofstream out(file.c_str());
+    if (!out) {
+        std::cerr<<"Cannot write the trace to "<<file<<"\n";
+        return false;
+    }
+    // tout ce qui finit après le début de la première image gardée
+    frames = std::max(1u, std::min(frames, (uint32_t)PROFILE_MAX_FRAMES));
+    int64_t from = s_nbFrames > frames ? s_frames[(s_nbFrames - frames) % PROFILE_MAX_FRAMES] : 0;
+
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    out<<"{\"traceEvents\":[\n";
+    bool first = true;
+    int nbRings = std::min((int)s_nbRings.fetchAndAddOrdered(0), PROFILE_MAX_THREADS);
+    uint32_t nbEvents = 0;
+    for (int t = 0; t < nbRings; t++) {
+        // compté mais pas encore rangé par ring()
+        Ring *r = s_rings[t].fetchAndAddAcquire(0);
+        if (!r)
+            continue;
+        out<<(first ? "" : ",\n")<<"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"<<t+1
+            <<",\"args\":{\"name\":\"";
+        if (t == 0)
+            out<<"main";
+        else
+            out<<"thread "<<t;
+        out<<"\"}}";
+        first = false;
+        int count = r->count.fetchAndAddAcquire(0);
+        // le thread peut écrire pendant ce temps: on laisse de la marge
+        // avant les événements qu'il est en train d'écraser
+        int oldest = std::max(0, count - PROFILE_RING_SIZE + PROFILE_RING_SIZE/16);
+        for (int i = oldest; i < count; i++) {
+            const Event &e = r->events[i & (PROFILE_RING_SIZE-1)];
+            if (e.end < from)
+                continue;
+            out<<",\n{\"name\":\""<<eventName(e.name)<<"\",\"ph\":\"X\",\"pid\":1,\"tid\":"<<t+1
+                <<",\"ts\":"<<e.begin/1e3<<",\"dur\":"<<(e.end - e.begin)/1e3<<"}";
+            nbEvents++;
+        }
+    }
+    // début des images, sur le premier thread
+    uint32_t firstFrame = s_nbFrames > frames ? s_nbFrames - frames : 0;
+    for (uint32_t f = firstFrame; f < s_nbFrames; f++) {
+        out<<(first ? "" : ",\n")<<"{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":1,\"ts\":"
+            <<s_frames[f % PROFILE_MAX_FRAMES]/1e3<<"}";
+        first = false;
+    }
+    out<<"\n]}\n";
+    std::cout<<"Wrote "<<nbEvents<<" events of "<<s_nbFrames - firstFrame<<" frames to "<<file<<"\n";
+    return true;
+}
@@ -0,0 +1,99 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+/*******************************************************************************
+ *  Profiler                                                                   *
+ *  Sun Jun 08 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include <QAtomicInt>
+#include <string>
+#include <typeinfo>
+#include <stdint.h>
+
+#define PROFILE_RING_SIZE 16384 // événements gardés par thread, puissance de 2
+#define PROFILE_MAX_THREADS 64 // au delà les threads ne sont pas mesurés
+#define PROFILE_MAX_FRAMES 1024 // débuts d'image gardés
+#define PROFILE_DUMP_FRAMES 120 // images écrites par défaut
+#define PROFILE_FILE "trace.json"
+
+#define PROFILE_CAT2(a, b) a##b
+#define PROFILE_CAT(a, b) PROFILE_CAT2(a, b)
+// mesure le temps jusqu'à la fin du bloc, name doit rester valide jusqu'au
+// dump (chaîne littérale ou typeid(...).name())
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CAT(profileScope, __LINE__)(name)
+// idem nommé par le type dynamique de *object, résolu seulement si le
+// profiler est activé
+#define PROFILE_OBJECT(object) Profiler::Scope PROFILE_CAT(profileScope, __LINE__)(object)
+
+// Temps CPU de blocs nommés, écrits sans verrou dans un anneau par thread:
+// seul le thread propriétaire écrit, et publie l'événement en incrémentant
+// un compteur atomique (release, relu en acquire par dump). dump écrit les
+// dernières images au format trace-event de Chrome (chrome://tracing,
+// Perfetto).
+// Désactivé, un Scope coûte deux tests et non un seul: le drapeau à
+// l'entrée et le nom gardé à la sortie. Le destructeur ne peut pas relire
+// le drapeau, qui a pu changer entre temps. Ni horloge ni donnée du thread.
+class Profiler {
+    public:
+        class Scope {
+            const char *m_name; // NULL si le profiler était désactivé
+            int64_t m_begin;
+        public:
+            inline Scope(const char *name) : m_name(NULL) {
+                if (s_enabled)
+                    begin(name);
+            }
+            template <class T>
+            inline explicit Scope(const T *object) : m_name(NULL) {
+                if (s_enabled)
+                    begin(typeid(*object).name());
+            }
+            inline ~Scope() {
+                if (m_name)
+                    end();
+            }
+        private:
+            void begin(const char *name);
+            void end();
+        };
+
+        static inline bool isEnabled() { return s_enabled != 0; }
+        static void setEnabled(bool onOff);
+        // à appeler au début de chaque image, depuis le thread de l'interface
+        static void newFrame();
+        // événements des frames dernières images de tous les threads,
+        // depuis le thread de l'interface
+        static bool dump(const std::string &file, uint32_t frames = PROFILE_DUMP_FRAMES);
+
+    private:
+        struct Event {
+            const char *name;
+            int64_t begin, end; // ns
+        };
+        struct Ring {
+            Event events[PROFILE_RING_SIZE];
+            QAtomicInt count; // événements publiés depuis le début
+            Ring() : count(0) {}
+        };
+
+        // lu sans barrière par tous les threads: un changement peut n'être
+        // vu qu'au Scope suivant, l'anneau et l'horloge ne dépendent pas de lui
+        static QAtomicInt s_enabled;
+        // rangés en release par le thread propriétaire, lus en acquire
+        static QAtomicPointer<Ring> s_rings[PROFILE_MAX_THREADS];
+        static QAtomicInt s_nbRings;
+        static int64_t s_frames[PROFILE_MAX_FRAMES];
+        static uint32_t s_nbFrames;
+
+        Profiler();
+
+        static int64_t now();
+        // anneau du thread courant, créé au premier appel, NULL si il y a
+        // trop de threads
+        static Ring *ring();
+};
+
+#endif
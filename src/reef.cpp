@@ -0,0 +1,74 @@
+#include "reef.hpp"
+#include "TextureManager.hpp"
+#include "renderQueue.hpp"
+#include <algorithm>
+
+static bool byTemplate(const Coral &a, const Coral &b)
+{
+    return a.getDepth() < b.getDepth() ||
+        (a.getDepth() == b.getDepth() && a.getVariant() < b.getVariant());
+}
+
+Reef::Reef() : m_texture(0)
+{
+}
+
+void Reef::addCoral(const Coral &c)
+{
+    m_corals.insert(std::upper_bound(m_corals.begin(), m_corals.end(), c, byTemplate), c);
+}
+
+void Reef::init(Viewer&)
+{
+    m_texture = TextureManager::getTexture("corail1");
+}
+
+void Reef::draw(int pass)
+{
+    if (pass == PASS_NORMAL) {
+        glBindTexture(GL_TEXTURE_2D, m_texture);
+        m_visible.resize(m_corals.size());
+        for (uint32_t i = 0; i < m_corals.size(); i++)
+            m_visible[i] = i;
+    }
+    drawItem(0, pass);
+}
+
+void Reef::submit(RenderQueue &queue, int pass)
+{
+    if (pass == PASS_NORMAL) {
+        m_visible.clear();
+        glm::vec3 center;
+        float radius;
+        for (uint32_t i = 0; i < m_corals.size(); i++) {
+            if (!m_corals[i].getBoundingSphere(center, radius) || queue.isVisible(center, radius))
+                m_visible.push_back(i);
+        }
+    }
+    if (!m_visible.empty())
+        queue.submit(this, 0, pass, RENDER_OPAQUE, m_texture);
+}
+
+// m_visible est rangé comme m_corals, par arbre
+void Reef::drawItem(uint32_t, int)
+{
+    if (m_visible.empty())
+        return;
+
+    Mesh *bound = NULL;
+    for (std::vector<uint32_t>::const_iterator i(m_visible.begin()); i != m_visible.end(); ++i) {
+        const Coral &coral = m_corals[*i];
+        Mesh &mesh = coral.getTemplate();
+        if (&mesh != bound) {
+            if (bound)
+                bound->unbind();
+            mesh.bind();
+            bound = &mesh;
+        }
+        glPushMatrix();
+        coral.applyTransform();
+        mesh.drawElements();
+        glPopMatrix();
+    }
+    bound->unbind();
+}
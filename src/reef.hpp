@@ -0,0 +1,35 @@
+#ifndef __REEF_H__
+#define __REEF_H__
+/*******************************************************************************
+ *  Reef                                                                       *
+ *  Wed Jun 04 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include "renderable.hpp"
+#include "coral.hpp"
+#include <vector>
+
+// Tous les coraux de la scène: triés par arbre partagé, chaque arbre n'est
+// bindé qu'une fois et chaque corail ne coûte qu'un glDrawElements.
+class Reef : public Renderable {
+    std::vector<Coral> m_corals;
+    std::vector<uint32_t> m_visible; // indices des coraux dans le frustum
+    GLuint m_texture;
+
+public:
+    Reef();
+    void addCoral(const Coral &c);
+    void init(Viewer &v);
+    void draw(int pass);
+    // un seul élément avec la texture des coraux, seuls les coraux
+    // visibles à la première passe sont dessinés dans les deux
+    void submit(RenderQueue &queue, int pass);
+    void drawItem(uint32_t, int pass);
+
+    inline uint32_t getNbCorals() const { return m_corals.size(); }
+};
+
+#endif
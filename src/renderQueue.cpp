@@ -0,0 +1,213 @@
+#include "renderQueue.hpp"
+#include <algorithm>
+#include <QGLContext>
+#include "profiler.hpp"
+
+typedef void (APIENTRY *ActiveTexture)(GLenum);
+static ActiveTexture s_activeTexture = NULL;
+
+RenderQueue::Material::Material() : shininess(0.f)
+{
+    const GLfloat a[4] = { 0.2f, 0.2f, 0.2f, 1.f },
+          d[4] = { 0.8f, 0.8f, 0.8f, 1.f },
+          s[4] = { 0.f, 0.f, 0.f, 1.f };
+    for (int i = 0; i < 4; i++) {
+        ambient[i] = a[i];
+        diffuse[i] = d[i];
+        specular[i] = s[i];
+    }
+}
+
+RenderQueue::Material::Material(const glm::vec3 &am, const glm::vec4 &sp) : shininess(0.f)
+{
+    Material def;
+    for (int i = 0; i < 4; i++) {
+        ambient[i] = i < 3 ? am[i] : 1.f;
+        diffuse[i] = def.diffuse[i];
+        specular[i] = sp[i];
+    }
+}
+
+void RenderQueue::Material::apply() const
+{
+    glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, ambient);
+    glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, diffuse);
+    glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, specular);
+    glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, shininess);
+}
+
+// par défaut un seul élément qui fait tout dans draw
+void Renderable::submit(RenderQueue &queue, int pass)
+{
+    queue.submit(this, 0, pass);
+}
+
+RenderQueue::RenderQueue() :
+    m_materials(1),
+    m_hasFrustum(false), m_culled(0), m_visible(0),
+    m_sorted(true), m_texture(RENDER_OWN_TEXTURE), m_material(0),
+    m_causticsUnit(0), m_caustics(false),
+    m_textureChanges(0), m_materialChanges(0)
+{
+    for (int i = 0; i < 16; i++)
+        m_modelview[i] = i%5 == 0 ? 1.f : 0.f;
+}
+
+uint32_t RenderQueue::addMaterial(const Material &m)
+{
+    if (m_materials.size() > RENDER_MAX_MATERIALS)
+        return 0;
+    m_materials.push_back(m);
+    return m_materials.size()-1;
+}
+
+void RenderQueue::begin()
+{
+    m_items.clear();
+    m_textureChanges = m_materialChanges = 0;
+    m_culled = m_visible = 0;
+    glGetFloatv(GL_MODELVIEW_MATRIX, m_modelview);
+}
+
+uint64_t RenderQueue::makeKey(int pass, int group, GLuint texture, uint32_t material, float depth)
+{
+    const uint64_t maxDepth = (1u << 24) - 1;
+    uint64_t d = depth <= 0.f ? 0 :
+        depth >= RENDER_DEPTH_RANGE ? maxDepth : (uint64_t)(depth/RENDER_DEPTH_RANGE*maxDepth);
+    uint64_t t = std::min(texture, (GLuint)RENDER_OWN_TEXTURE),
+             m = material & RENDER_MAX_MATERIALS,
+             key = (uint64_t)(pass & 1) << 63 | (uint64_t)(group & 3) << 61;
+    if (group == RENDER_TRANSPARENT)
+        return key | (maxDepth - d) << 37 | t << 21 | m << 9;
+    return key | t << 45 | m << 33 | d << 9;
+}
+
+void RenderQueue::submit(Renderable *r, uint32_t item, int pass, int group,
+        GLuint texture, uint32_t material, float depth)
+{
+    Item it;
+    // le fond garde l'ordre de soumission
+    it.key = makeKey(pass, group, texture, material, group == RENDER_BACKGROUND ? 0.f : depth);
+    it.object = r;
+    it.item = item;
+    it.pass = pass;
+    it.group = group;
+    it.texture = std::min(texture, (GLuint)RENDER_OWN_TEXTURE);
+    it.material = material & RENDER_MAX_MATERIALS;
+    it.order = m_items.size();
+    m_items.push_back(it);
+}
+
+float RenderQueue::depth(const glm::vec3 &p) const
+{
+    return -(m_modelview[2]*p.x + m_modelview[6]*p.y + m_modelview[10]*p.z + m_modelview[14]);
+}
+
+void RenderQueue::setFrustum(const GLdouble planes[6][4])
+{
+    for (int i = 0; i < 6; i++)
+        m_planes[i] = glm::vec4(planes[i][0], planes[i][1], planes[i][2], planes[i][3]);
+    m_hasFrustum = true;
+}
+
+// dehors dès que le centre est à plus de radius derrière un des plans
+bool RenderQueue::isVisible(const glm::vec3 &center, float radius)
+{
+    if (m_hasFrustum) {
+        for (int i = 0; i < 6; i++) {
+            const glm::vec4 &p = m_planes[i];
+            if (p.x*center.x + p.y*center.y + p.z*center.z - p.w > radius) {
+                m_culled++;
+                return false;
+            }
+        }
+    }
+    m_visible++;
+    return true;
+}
+
+void RenderQueue::sort()
+{
+    if (m_sorted)
+        std::sort(m_items.begin(), m_items.end());
+}
+
+void RenderQueue::bindTexture(GLuint texture)
+{
+    if (m_sorted && texture == m_texture)
+        return;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    m_texture = texture;
+    m_textureChanges++;
+}
+
+void RenderQueue::useMaterial(uint32_t material)
+{
+    if (material == m_material && (m_sorted || material == 0))
+        return;
+    m_materials[material].apply();
+    m_material = material;
+    m_materialChanges++;
+}
+
+bool RenderQueue::hasMultitexture()
+{
+    if (!s_activeTexture && QGLContext::currentContext())
+        s_activeTexture = (ActiveTexture)QGLContext::currentContext()->getProcAddress("glActiveTexture");
+    if (!s_activeTexture)
+        return false;
+    GLint units = 1;
+    glGetIntegerv(GL_MAX_TEXTURE_UNITS, &units);
+    return units >= 2;
+}
+
+void RenderQueue::activeTexture(GLenum unit)
+{
+    if (s_activeTexture)
+        s_activeTexture(unit);
+}
+
+void RenderQueue::enableCaustics(bool onOff)
+{
+    if (onOff == m_caustics)
+        return;
+    activeTexture(m_causticsUnit);
+    if (onOff)
+        glEnable(GL_TEXTURE_2D);
+    else
+        glDisable(GL_TEXTURE_2D);
+    activeTexture(GL_TEXTURE0);
+    m_caustics = onOff;
+    m_textureChanges++;
+}
+
+void RenderQueue::execute(int pass)
+{
+    // les objets dessinés hors de la queue ont pu tout changer
+    m_texture = RENDER_OWN_TEXTURE;
+    m_material = 0;
+    m_caustics = m_causticsUnit != 0;
+    for (std::vector<Item>::const_iterator it(m_items.begin()); it != m_items.end(); ++it) {
+        if (it->pass != pass)
+            continue;
+        // la texture des caustiques reste bindée pendant leur passe
+        if (pass == PASS_NORMAL) {
+            if (m_causticsUnit)
+                enableCaustics(it->group == RENDER_OPAQUE);
+            if (it->texture != RENDER_OWN_TEXTURE)
+                bindTexture(it->texture);
+            useMaterial(it->material);
+        }
+        {
+            PROFILE_OBJECT(it->object);
+            it->object->drawItem(it->item, pass);
+        }
+        if (it->texture == RENDER_OWN_TEXTURE)
+            m_texture = RENDER_OWN_TEXTURE;
+        // sans tri chaque objet remet le matériau par défaut derrière lui
+        else if (pass == PASS_NORMAL && !m_sorted)
+            useMaterial(0);
+    }
+    if (pass == PASS_NORMAL)
+        useMaterial(0);
+}
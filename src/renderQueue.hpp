@@ -0,0 +1,135 @@
+#ifndef __RENDER_QUEUE_H__
+#define __RENDER_QUEUE_H__
+/*******************************************************************************
+ *  RenderQueue                                                                *
+ *  Sun Jun 08 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include "renderable.hpp"
+#ifndef __APPLE__
+#include <GL/glut.h>
+#else
+#include <GLUT/glut.h>
+#endif
+#include <vector>
+#include <stdint.h>
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+
+// groupes dessinés dans cet ordre dans chaque passe
+#define RENDER_BACKGROUND 0 // ordre de soumission (skybox)
+#define RENDER_OPAQUE 1 // par texture, matériau puis de près à loin
+#define RENDER_TRANSPARENT 2 // de loin à près puis par texture, matériau
+
+// l'objet binde lui-même ses textures dans draw
+#define RENDER_OWN_TEXTURE 0xffffu
+#define RENDER_MAX_MATERIALS 0xfffu
+#define RENDER_DEPTH_RANGE 1000.f // au delà les profondeurs sont égales
+
+// Ce que la Viewer dessine dans une image: chaque Renderable y soumet des
+// éléments (cf Renderable::submit) avec une clé de 64 bits
+//   opaque:      passe:1 groupe:2 texture:16 matériau:12 profondeur:24
+//   transparent: passe:1 groupe:2 éloignement:24 texture:16 matériau:12
+// triées une fois par image. La queue garde la texture et le matériau
+// courants et ne refait ni glBindTexture ni glMaterial quand l'élément
+// suivant a les mêmes. Un élément RENDER_OWN_TEXTURE peut changer la
+// texture, la suivante est toujours rebindée.
+// Avec les caustiques en une passe, l'unité de texture qui les porte n'est
+// activée que pour les éléments opaques: ni le fond ni les objets
+// transparents n'en avaient dans la seconde passe.
+class RenderQueue {
+    public:
+        struct Material {
+            GLfloat ambient[4], diffuse[4], specular[4], shininess;
+            // valeurs par défaut d'OpenGL, c'est le matériau 0
+            Material();
+            Material(const glm::vec3 &ambient, const glm::vec4 &specular);
+            void apply() const;
+        };
+
+        RenderQueue();
+
+        // renvoie l'indice à mettre dans les clés
+        uint32_t addMaterial(const Material &m);
+
+        // vide la queue, la profondeur est calculée avec la modelview courante
+        void begin();
+        // item est rendu à r->drawItem
+        void submit(Renderable *r, uint32_t item, int pass, int group = RENDER_OPAQUE,
+                GLuint texture = RENDER_OWN_TEXTURE, uint32_t material = 0, float depth = 0.f);
+        // distance à la caméra le long de la direction de vue
+        float depth(const glm::vec3 &p) const;
+
+        // plans du frustum de la caméra pour l'image, au format de
+        // qglviewer::Camera::getFrustumPlanesCoefficients (normales vers
+        // l'extérieur), sans eux tout est visible
+        void setFrustum(const GLdouble planes[6][4]);
+        // la sphère touche le frustum, compté dans getNbCulled/getNbVisible
+        bool isVisible(const glm::vec3 &center, float radius);
+        void sort();
+        // dessine les éléments de pass, dans l'ordre de tri
+        void execute(int pass);
+
+        // sans tri, les éléments sont dessinés dans l'ordre de soumission
+        // et chacun rebinde sa texture et son matériau, comme avant
+        inline void setSorted(bool onOff) { m_sorted = onOff; }
+
+        // unité (GL_TEXTURE1...) déjà préparée avec les caustiques, 0 si
+        // elles sont dessinées dans une seconde passe. Elle peut être
+        // désactivée à la fin de execute.
+        inline void setCausticsUnit(GLenum unit) { m_causticsUnit = unit; }
+
+        // glActiveTexture existe et il y a au moins 2 unités, à appeler
+        // avec un contexte courant
+        static bool hasMultitexture();
+        static void activeTexture(GLenum unit);
+        inline bool isSorted() const { return m_sorted; }
+
+        // glBindTexture et matériaux envoyés depuis begin, sans compter
+        // ceux des éléments RENDER_OWN_TEXTURE
+        inline uint32_t getStateChanges() const { return m_textureChanges + m_materialChanges; }
+        inline uint32_t getTextureChanges() const { return m_textureChanges; }
+        inline uint32_t getMaterialChanges() const { return m_materialChanges; }
+        inline uint32_t getNbItems() const { return m_items.size(); }
+        // sphères testées par isVisible depuis begin
+        inline uint32_t getNbCulled() const { return m_culled; }
+        inline uint32_t getNbVisible() const { return m_visible; }
+
+    private:
+        struct Item {
+            uint64_t key;
+            Renderable *object;
+            uint32_t item, order;
+            // aussi dans la clé
+            int pass, group;
+            GLuint texture;
+            uint32_t material;
+            inline bool operator<(const Item &o) const {
+                return key < o.key || (key == o.key && order < o.order);
+            }
+        };
+
+        std::vector<Item> m_items;
+        std::vector<Material> m_materials;
+        GLfloat m_modelview[16];
+        glm::vec4 m_planes[6];
+        bool m_hasFrustum;
+        uint32_t m_culled, m_visible;
+        bool m_sorted;
+        // état courant, RENDER_OWN_TEXTURE quand il est inconnu
+        GLuint m_texture;
+        uint32_t m_material;
+        GLenum m_causticsUnit;
+        bool m_caustics; // l'unité des caustiques est activée
+        uint32_t m_textureChanges, m_materialChanges;
+
+        static uint64_t makeKey(int pass, int group, GLuint texture, uint32_t material, float depth);
+        void bindTexture(GLuint texture);
+        void useMaterial(uint32_t material);
+        void enableCaustics(bool onOff);
+};
+
+#endif
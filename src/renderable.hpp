@@ -1,11 +1,27 @@
 #ifndef _RENDERABLE_
 #define _RENDERABLE_
 #include <QKeyEvent>
+#include <stdint.h>
+#include "glm/vec3.hpp"
 
 class Viewer;
+class RenderQueue;
 #define PASS_NORMAL 0
 #define PASS_CAUSTIC 1
 
+/**
+ * Reference to a Renderable owned by the Viewer. The generation changes
+ * when the renderable is removed, so Viewer::getRenderable returns NULL for
+ * a handle kept after the object was destroyed instead of a dangling
+ * pointer.
+ */
+struct RenderableHandle
+{
+    uint32_t index, generation;
+    RenderableHandle() : index((uint32_t)-1), generation(0) {}
+    RenderableHandle(uint32_t i, uint32_t g) : index(i), generation(g) {}
+};
+
 /**
  * General interface of renderable objetcs, that can be displayed
  * in the Viewer class.
@@ -14,10 +30,26 @@ class Viewer;
  */
 class Renderable
 {
+    friend class Viewer;
+
+    bool m_alive;
+    RenderableHandle m_handle;
+
     public:
+        Renderable() : m_alive(true) {}
+
         /// Virtual destructor (mandatory!)
         virtual ~Renderable() {};
 
+        /**
+         * A killed object is neither animated nor drawn anymore, the Viewer
+         * removes and deletes it between two frames.
+         */
+        inline void kill() { m_alive = false; }
+        inline bool isAlive() const { return m_alive; }
+        /// Set by Viewer::addRenderable
+        inline const RenderableHandle &getHandle() const { return m_handle; }
+
         /** 
          * Initializes a Renderable objet before it is draw.
          * Default behavior: nothing is done.
@@ -31,6 +63,29 @@ class Renderable
          */
         virtual void draw(int pass) = 0;
 
+        /**
+         * Submit the draw items of the object for this pass to the render
+         * queue of the Viewer, which sorts them by state and depth.
+         * Default behavior: one opaque item drawn with draw(pass), that
+         * binds its own textures (see RenderQueue).
+         */
+        virtual void submit(RenderQueue &queue, int pass);
+
+        /**
+         * Draw one item submitted by submit(). The texture and material of
+         * the item are already bound when it has one.
+         * Default behavior: draw(pass).
+         */
+        virtual void drawItem(uint32_t, int pass) { draw(pass); }
+
+        /**
+         * Sphere containing everything draw() renders, in world
+         * coordinates. The Viewer does not submit objects out of the camera
+         * frustum.
+         * Default behavior: no bounds (false), the object is never culled.
+         */
+        virtual bool getBoundingSphere(glm::vec3 &, float &) const { return false; }
+
         /** 
          * Animate an object. This method is invoked before each call of draw().
          * Default behavior: nothing is done.
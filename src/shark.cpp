@@ -1,6 +1,14 @@
 #include "shark.hpp"
+#include <algorithm>
 #include "objManager.hpp"
 #include "const.hpp"
+#include <cmath>
+
+// tick de la seconde s
+static inline float tick(float s)
+{
+    return floor(fps*s+0.5f);
+}
 
 Shark::Shark() :
     m_body(objManager::getObj("shark")),
@@ -8,11 +16,39 @@ Shark::Shark() :
     m_eyes(objManager::getObj("shark_eyes")),
     m_chest(objManager::getObj("chest")),
     m_viewer(NULL),
-    m_timer(0),
     m_pos(0, BEG_SHARK, COMMON_HEIGHT),
     m_rot(0),
     m_showChest(false)
-{}
+{
+    //Le requin avance doucement
+    during(4, 8, glm::vec3(0, -vitesseLenteRequin, 0));
+    //Le requin avance rapidement
+    during(11, 12, glm::vec3(0, -vitesseRapideRequin, 0));
+    //Bisou
+    during(15, 16, glm::vec3(0, -distanceFaceAFace/fps, 0));
+    during(16, 17, glm::vec3(0, distanceFaceAFace/fps, 0));
+    //Le requin recule
+    during(18, 19, glm::vec3(0, distanceReculeRequin/fps, 0));
+    //Le requin se tourne
+    m_turn.add(tick(19)+1, tick(19.3), rotationRequin/(fps*.3));
+    //Le requin s'enfonce
+    during(19.3, 19.6, glm::vec3(0, 0, -(COMMON_HEIGHT-profondeurRequin)/(fps*.3)));
+    m_chestTrack.add(tick(24.2)+1, true);
+
+    Timeline::subscribe(this);
+    seek(Timeline::getTime());
+}
+
+Shark::~Shark()
+{
+    Timeline::unsubscribe(this);
+}
+
+void Shark::during(float from, float to, const glm::vec3 &speed)
+{
+    // premier tick après from, jusqu'au dernier tick avant to
+    m_move.add(tick(from)+1, tick(to), speed);
+}
 
 void Shark::draw(int pass)
 {
@@ -32,40 +68,30 @@ void Shark::draw(int pass)
     glPopMatrix();
 }
 
+bool Shark::getBoundingSphere(glm::vec3 &center, float &radius) const
+{
+    center = m_pos;
+    if (m_showChest)
+        radius = m_chest.getOriginRadius();
+    else
+        radius = std::max(m_body.getOriginRadius(),
+                std::max(m_teeth.getOriginRadius(), m_eyes.getOriginRadius()));
+    return true;
+}
+
 void Shark::animate()
 {
-    if (m_timer > fps*4 && m_timer < fps*8) {
-        //Le requin avance doucement
-        m_pos.y -= vitesseLenteRequin;
-    }
-    if (m_timer > fps*11 && m_timer < fps*12) {
-        //Le requin avance rapidement
-        m_pos.y -= vitesseRapideRequin;
-    }
-    if (m_timer > fps*15 && m_timer < fps*16) {
-        //Bisou
-        m_pos.y -= distanceFaceAFace/fps;
-    }
-    if (m_timer > fps*16 && m_timer < fps*17) {
-        //Bisou
-        m_pos.y += distanceFaceAFace/fps;
-    }
-    if (m_timer > fps*18 && m_timer < fps*19) {
-        //Le requin recule
-        m_pos.y += distanceReculeRequin/fps;
-    }
-    if (m_timer > fps*19 && m_timer < fps*19.3) {
-        //Le requin se tourne
-        m_rot += rotationRequin/(fps*.3);
-    }
-    if (m_timer > fps*19.3 && m_timer < fps*19.6) {
-        //Le requin s'enfonce
-        m_pos.z -= (COMMON_HEIGHT-profondeurRequin)/(fps*.3);
-    }
-    if (m_timer > fps*24.2) {
-        m_showChest = true;
+    seek(Timeline::getTime());
+}
+
+void Shark::seek(float time)
+{
+    // état après le tick time
+    m_pos = glm::vec3(0, BEG_SHARK, COMMON_HEIGHT) + m_move.at(time+1);
+    m_rot = m_turn.at(time+1);
+    m_showChest = m_chestTrack.at(time, false);
+    if (m_showChest) {
         m_rot = 0;
         m_pos.z = 0;
     }
-    m_timer++;
 }
@@ -9,17 +9,30 @@
  ******************************************************************************/
 
 #include "objReader.hpp"
+#include "timeline.hpp"
 
-class Shark : public Renderable {
+// Le requin ne garde pas d'état: sa position à un instant est lue sur ses
+// pistes, on peut donc le placer à n'importe quel moment de l'histoire.
+class Shark : public Renderable, public Timeline::Actor {
     objReader &m_body, &m_teeth, &m_eyes, &m_chest;
     Viewer *m_viewer;
-    uint32_t m_timer;
     glm::vec3 m_pos;
+    RampTrack<glm::vec3> m_move; // déplacement depuis le début
+    RampTrack<float> m_turn;
+    StepTrack<bool> m_chestTrack; // le requin est remplacé par le coffre
+
+    // entre les secondes from et to (exclues), comme les anciens tests sur
+    // le timer
+    void during(float from, float to, const glm::vec3 &speed);
 
     public:
     Shark();
     void draw(int pass);
+    // autour de m_pos, pour toutes les orientations
+    bool getBoundingSphere(glm::vec3 &center, float &radius) const;
+    ~Shark();
     void animate();
+    void seek(float time);
     inline virtual void init(Viewer& v) {m_viewer = &v;};
     private:
     float m_rot;
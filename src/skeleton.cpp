@@ -0,0 +1,51 @@
+#include "skeleton.hpp"
+#ifndef __APPLE__
+#include <GL/glut.h>
+#else
+#include <GLUT/glut.h>
+#endif
+#include "glm/gtc/type_ptr.hpp"
+#include <cmath>
+
+glm::quat Skeleton::axisAngle(float degrees, const glm::vec3 &axis)
+{
+    float a = degrees*M_PI/360.f; // moitié de l'angle, en radians
+    float s = sin(a);
+    return glm::quat(cos(a), axis.x*s, axis.y*s, axis.z*s);
+}
+
+int Skeleton::addJoint(int parent, const glm::vec3 &offset)
+{
+    m_parents.push_back(parent);
+    m_offsets.push_back(offset);
+    m_rotations.push_back(glm::quat());
+    m_world.push_back(glm::mat4(1.f));
+    return m_parents.size()-1;
+}
+
+glm::quat Skeleton::euler(const glm::vec3 &angles)
+{
+    return axisAngle(angles.x, glm::vec3(1.f, 0.f, 0.f)) *
+        axisAngle(angles.y, glm::vec3(0.f, 1.f, 0.f)) *
+        axisAngle(angles.z, glm::vec3(0.f, 0.f, 1.f));
+}
+
+void Skeleton::update()
+{
+    if (!m_parents.empty())
+        evaluate(m_offsets[0], &m_rotations[0], &m_world[0]);
+}
+
+void Skeleton::evaluate(const glm::vec3 &root, const glm::quat *rotations, glm::mat4 *world) const
+{
+    for (size_t i = 0; i < m_parents.size(); i++) {
+        glm::mat4 local(glm::mat4_cast(rotations[i]));
+        local[3] = glm::vec4(i == 0 ? root : m_offsets[i], 1.f);
+        world[i] = m_parents[i] < 0 ? local : world[m_parents[i]]*local;
+    }
+}
+
+void Skeleton::load(int joint) const
+{
+    glMultMatrixf(glm::value_ptr(m_world[joint]));
+}
@@ -0,0 +1,59 @@
+#ifndef __SKELETON_H__
+#define __SKELETON_H__
+/*******************************************************************************
+ *  Skeleton                                                                   *
+ *  Thu Jun 05 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include <vector>
+#include "glm/vec3.hpp"
+#include "glm/mat4x4.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+// Hiérarchie d'articulations rangée à plat: chaque articulation connaît
+// l'indice de son parent, qui est toujours ajouté avant elle. Les matrices
+// monde sont donc toutes calculées en un seul parcours, une fois par tick,
+// et draw n'a plus qu'à les charger.
+class Skeleton {
+    std::vector<int> m_parents; // -1 pour la racine
+    std::vector<glm::vec3> m_offsets; // position dans le repère du parent
+    std::vector<glm::quat> m_rotations; // rotation locale
+    std::vector<glm::mat4> m_world;
+
+public:
+    // renvoie l'indice de la nouvelle articulation
+    int addJoint(int parent, const glm::vec3 &offset);
+
+    inline void setOffset(int joint, const glm::vec3 &offset) { m_offsets[joint] = offset; }
+    inline void setRotation(int joint, const glm::quat &q) { m_rotations[joint] = q; }
+    // angles en degrés, appliqués comme glRotatef selon x, puis y, puis z
+    inline void setRotation(int joint, const glm::vec3 &angles) { m_rotations[joint] = euler(angles); }
+
+    // recalcule toutes les matrices monde
+    void update();
+    // matrices monde d'une autre instance du même squelette, avec ses
+    // propres rotations et root à la place de la position de la première
+    // articulation. Le squelette n'est pas modifié, on peut donc l'appeler
+    // depuis plusieurs threads.
+    void evaluate(const glm::vec3 &root, const glm::quat *rotations, glm::mat4 *world) const;
+
+    inline const glm::quat& getRotation(int joint) const { return m_rotations[joint]; }
+    inline const glm::mat4& getWorld(int joint) const { return m_world[joint]; }
+    inline glm::vec3 getPosition(int joint) const { return glm::vec3(m_world[joint][3]); }
+    // point p du repère de l'articulation dans le repère monde
+    inline glm::vec3 transform(int joint, const glm::vec3 &p) const { return glm::vec3(m_world[joint]*glm::vec4(p, 1.f)); }
+    // multiplie la matrice courante par la matrice monde de l'articulation
+    void load(int joint) const;
+
+    inline int getNbJoints() const { return m_parents.size(); }
+
+    // rotation d'angle degrés autour de axis (normé)
+    static glm::quat axisAngle(float degrees, const glm::vec3 &axis);
+    // même ordre que setRotation
+    static glm::quat euler(const glm::vec3 &angles);
+};
+
+#endif
@@ -3,9 +3,14 @@ using namespace std;
 #include "skybox.hpp"
 #include "TextureManager.hpp"
 #include "globals.hpp"
+#include "renderQueue.hpp"
 
 Skybox::Skybox() {}
 
+void Skybox::submit(RenderQueue &queue, int pass) {
+	queue.submit(this, 0, pass, RENDER_BACKGROUND);
+}
+
 void Skybox::draw(int pass) {
 	// Configuration des états OpenGL
         glPushAttrib(GL_ENABLE_BIT);
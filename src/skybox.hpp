@@ -13,6 +13,8 @@ class Skybox : public Renderable
     public:
         Skybox();
         void draw(int pass);
+        // drawn first, before the sorted objects
+        void submit(RenderQueue &queue, int pass);
 
     private:
 		void drawCrate(float size, int pass);
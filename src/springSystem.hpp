@@ -0,0 +1,345 @@
+#ifndef __SPRING_SYSTEM_H__
+#define __SPRING_SYSTEM_H__
+/*******************************************************************************
+ *  SpringSystem                                                               *
+ *  Sat Jun 07 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include "glm/vec3.hpp"
+#include "glm/geometric.hpp"
+
+// Cœur masses-ressorts de DynamicSystem, sans OpenGL ni QGLViewer pour
+// pouvoir le mesurer sans fenêtre. Real est le type des scalaires et Vec3
+// celui des vecteurs, qui doit avoir x et les opérateurs de glm et être
+// accepté par glm::dot et glm::length: SpringSystem<float, glm::vec3> pour
+// la scène, SpringSystem<double, glm::dvec3> pour valider.
+// Les particules sont rangées en tableaux contigus, les ressorts sont des
+// paires d'indices: un pas est une suite de passes linéaires sans
+// allocation.
+template <class Real, class Vec3>
+class SpringSystem {
+public:
+    enum integrator_t {
+        e_explicit, // Euler symplectique
+        e_implicit // Euler implicite linéarisé, résolu par gradient conjugué
+    };
+
+private:
+    struct spring_t {
+        uint32_t a, b;
+        Real stiffness, restLength, damping;
+    };
+
+    // particule i: (m_positions[i], m_velocities[i], ...)
+    std::vector<Vec3> m_positions, m_velocities, m_forces;
+    std::vector<Real> m_masses, m_invMasses, m_radii; // 1/m = 0 si fixe
+    std::vector<spring_t> m_springs;
+    std::vector<uint32_t> m_sweepOrder; // particules triées selon x
+
+    // implicite: direction et 1 - l0/l de chaque ressort pour le pas en
+    // cours, inconnue (variation de vitesse) et vecteurs du gradient
+    std::vector<Vec3> m_springDirs;
+    std::vector<Real> m_springRatios;
+    std::vector<Vec3> m_deltaV, m_r, m_p, m_q;
+
+    Vec3 m_gravity;
+    Real m_viscosity, m_dt, m_rebound;
+    Vec3 m_groundPosition, m_groundNormal;
+    bool m_collisions;
+    integrator_t m_integrator;
+    uint32_t m_cgMaxIterations;
+    Real m_cgTolerance; // relative au second membre
+
+    void computeForces()
+    {
+        const uint32_t n = m_positions.size();
+        for (uint32_t i = 0; i < n; i++)
+            m_forces[i] = m_gravity*m_masses[i] - m_velocities[i]*m_viscosity;
+
+        // force sur a due à b, et l'opposée sur b
+        for (uint32_t i = 0; i < m_springs.size(); i++) {
+            const spring_t &s = m_springs[i];
+            Vec3 u(m_positions[s.a] - m_positions[s.b]);
+            Real l = glm::length(u);
+            if (l < Real(1e-6))
+                continue;
+            u /= l;
+            Vec3 f(u*(-s.stiffness*(l - s.restLength)
+                        - s.damping*glm::dot(m_velocities[s.a] - m_velocities[s.b], u)));
+            m_forces[s.a] += f;
+            m_forces[s.b] -= f;
+        }
+    }
+
+    void stepExplicit()
+    {
+        computeForces();
+        for (uint32_t i = 0; i < m_positions.size(); i++) {
+            m_velocities[i] += m_forces[i]*(m_dt*m_invMasses[i]);
+            m_positions[i] += m_velocities[i]*m_dt;
+        }
+    }
+
+    // y = A.x avec A = M - dt.df/dv - dt².df/dx, particules fixes filtrées.
+    // Pour un ressort K = k.(c.I + (1-c).u.u^T), c = max(0, 1 - l0/l), et
+    // D = d.u.u^T: le bloc (a, a) vaut dt².K + dt.D, le bloc (a, b) son
+    // opposé.
+    void multiply(const std::vector<Vec3> &x, std::vector<Vec3> &y) const
+    {
+        const uint32_t n = m_positions.size();
+        for (uint32_t i = 0; i < n; i++)
+            y[i] = x[i]*(m_masses[i] + m_dt*m_viscosity);
+        for (uint32_t i = 0; i < m_springs.size(); i++) {
+            const spring_t &s = m_springs[i];
+            const Vec3 &u = m_springDirs[i];
+            const Real c = m_springRatios[i];
+            Vec3 dx(x[s.a] - x[s.b]);
+            Real along = glm::dot(u, dx);
+            Vec3 f((dx*c + u*((Real(1) - c)*along))*(m_dt*m_dt*s.stiffness)
+                    + u*(m_dt*s.damping*along));
+            y[s.a] += f;
+            y[s.b] -= f;
+        }
+        for (uint32_t i = 0; i < n; i++)
+            if (m_invMasses[i] == Real(0))
+                y[i] = Vec3();
+    }
+
+    // Baraff et Witkin: (M - dt.df/dv - dt².df/dx) dv = dt.(f + dt.df/dx.v)
+    void stepImplicit()
+    {
+        const uint32_t n = m_positions.size();
+        if (m_deltaV.size() != n) {
+            m_deltaV.resize(n);
+            m_r.resize(n);
+            m_p.resize(n);
+            m_q.resize(n);
+        }
+        if (m_springDirs.size() != m_springs.size()) {
+            m_springDirs.resize(m_springs.size());
+            m_springRatios.resize(m_springs.size());
+        }
+
+        computeForces();
+
+        // ressorts linéarisés autour des positions actuelles
+        for (uint32_t i = 0; i < m_springs.size(); i++) {
+            const spring_t &s = m_springs[i];
+            Vec3 u(m_positions[s.a] - m_positions[s.b]);
+            Real l = glm::length(u);
+            if (l < Real(1e-6)) {
+                m_springDirs[i] = Vec3();
+                m_springRatios[i] = Real(0);
+                continue;
+            }
+            m_springDirs[i] = u/l;
+            // un ressort comprimé rendrait le système indéfini
+            m_springRatios[i] = std::max(Real(0), Real(1) - s.restLength/l);
+        }
+
+        // second membre dt.(f + dt.df/dx.v) dans m_r
+        for (uint32_t i = 0; i < n; i++)
+            m_r[i] = m_forces[i]*m_dt;
+        for (uint32_t i = 0; i < m_springs.size(); i++) {
+            const spring_t &s = m_springs[i];
+            const Vec3 &u = m_springDirs[i];
+            const Real c = m_springRatios[i];
+            Vec3 dv(m_velocities[s.a] - m_velocities[s.b]);
+            Vec3 f((dv*c + u*((Real(1) - c)*glm::dot(u, dv)))*(m_dt*m_dt*s.stiffness));
+            m_r[s.a] -= f;
+            m_r[s.b] += f;
+        }
+
+        // gradient conjugué depuis dv = 0, donc r = b
+        Real rr = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            if (m_invMasses[i] == Real(0))
+                m_r[i] = Vec3();
+            m_deltaV[i] = Vec3();
+            m_p[i] = m_r[i];
+            rr += glm::dot(m_r[i], m_r[i]);
+        }
+        const Real threshold = m_cgTolerance*m_cgTolerance*rr;
+        for (uint32_t k = 0; k < m_cgMaxIterations && rr > threshold; k++) {
+            multiply(m_p, m_q);
+            Real pq = 0;
+            for (uint32_t i = 0; i < n; i++)
+                pq += glm::dot(m_p[i], m_q[i]);
+            if (pq <= Real(0))
+                break;
+            Real alpha = rr/pq, rrNew = 0;
+            for (uint32_t i = 0; i < n; i++) {
+                m_deltaV[i] += m_p[i]*alpha;
+                m_r[i] -= m_q[i]*alpha;
+                rrNew += glm::dot(m_r[i], m_r[i]);
+            }
+            Real beta = rrNew/rr;
+            for (uint32_t i = 0; i < n; i++)
+                m_p[i] = m_r[i] + m_p[i]*beta;
+            rr = rrNew;
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            m_velocities[i] += m_deltaV[i];
+            m_positions[i] += m_velocities[i]*m_dt;
+        }
+    }
+
+    // Sweep and prune selon x: l'ordre de la dernière fois est presque trié,
+    // le tri par insertion est donc quasiment linéaire. Chaque paire dont
+    // les intervalles se recouvrent sur x est testée une seule fois.
+    void sweepAndPrune()
+    {
+        const uint32_t n = m_positions.size();
+        if (m_sweepOrder.size() != n) {
+            m_sweepOrder.resize(n);
+            for (uint32_t i = 0; i < n; i++)
+                m_sweepOrder[i] = i;
+        }
+
+        for (uint32_t k = 1; k < n; k++) {
+            uint32_t idx = m_sweepOrder[k];
+            Real x = m_positions[idx].x - m_radii[idx];
+            uint32_t m = k;
+            for (; m > 0; m--) {
+                uint32_t prev = m_sweepOrder[m-1];
+                if (m_positions[prev].x - m_radii[prev] <= x)
+                    break;
+                m_sweepOrder[m] = prev;
+            }
+            m_sweepOrder[m] = idx;
+        }
+
+        for (uint32_t k = 0; k < n; k++) {
+            uint32_t i = m_sweepOrder[k];
+            Real maxX = m_positions[i].x + m_radii[i];
+            for (uint32_t m = k+1; m < n; m++) {
+                uint32_t j = m_sweepOrder[m];
+                if (m_positions[j].x - m_radii[j] > maxX)
+                    break;
+                // seule la deuxième particule peut être fixe
+                if (m_invMasses[i] != Real(0))
+                    collideParticles(i, j);
+                else if (m_invMasses[j] != Real(0))
+                    collideParticles(j, i);
+            }
+        }
+    }
+
+    // i1 ne doit pas être fixe
+    void collideParticles(uint32_t i1, uint32_t i2)
+    {
+        Vec3 p(m_positions[i2] - m_positions[i1]);
+        Real l = glm::length(p),
+             penetration = l - m_radii[i1] - m_radii[i2];
+        if (penetration >= Real(0) || l == Real(0))
+            return;
+        p /= l;
+
+        Vec3 vel(m_velocities[i1] - m_velocities[i2]);
+        Real m1 = m_masses[i1], m2 = m_masses[i2],
+             impulse = glm::dot(p, vel)*(Real(1) + m_rebound);
+
+        m_positions[i1] += p*(penetration*Real(0.5));
+        m_velocities[i1] -= p*(m2/(m1 + m2)*impulse);
+        if (m_invMasses[i2] == Real(0))
+            return;
+        m_positions[i2] -= p*(penetration*Real(0.5));
+        m_velocities[i2] += p*(m1/(m1 + m2)*impulse);
+    }
+
+public:
+    SpringSystem() :
+        m_gravity(Real(0), Real(0), Real(-10)), m_viscosity(1), m_dt(Real(0.1)),
+        m_rebound(Real(0.5)), m_groundNormal(Real(0), Real(0), Real(1)),
+        m_collisions(true), m_integrator(e_explicit),
+        m_cgMaxIterations(50), m_cgTolerance(Real(1e-6))
+    {}
+
+    void clear()
+    {
+        m_positions.clear();
+        m_velocities.clear();
+        m_forces.clear();
+        m_masses.clear();
+        m_invMasses.clear();
+        m_radii.clear();
+        m_springs.clear();
+        m_sweepOrder.clear();
+    }
+
+    // masse 0 pour une particule fixe, renvoie son indice
+    uint32_t addParticle(const Vec3 &pos, const Vec3 &vel, Real mass, Real radius)
+    {
+        m_positions.push_back(pos);
+        m_velocities.push_back(vel);
+        m_forces.push_back(Vec3());
+        m_masses.push_back(mass);
+        m_invMasses.push_back(mass > Real(0) ? Real(1)/mass : Real(0));
+        m_radii.push_back(radius);
+        return m_positions.size()-1;
+    }
+
+    void addSpring(uint32_t a, uint32_t b, Real stiffness, Real restLength, Real damping)
+    {
+        spring_t s;
+        s.a = a;
+        s.b = b;
+        s.stiffness = stiffness;
+        s.restLength = restLength;
+        s.damping = damping;
+        m_springs.push_back(s);
+    }
+
+    // forces et intégration puis collisions entre particules
+    void step()
+    {
+        if (m_integrator == e_implicit)
+            stepImplicit();
+        else
+            stepExplicit();
+        if (m_collisions)
+            sweepAndPrune();
+    }
+
+    // collision avec le sol fixe, non utilisée par la scène
+    void collideGround(uint32_t i)
+    {
+        if (m_invMasses[i] == Real(0))
+            return;
+        Real penetration = glm::dot(m_positions[i] - m_groundPosition, m_groundNormal) - m_radii[i];
+        if (penetration >= Real(0))
+            return;
+        Real vPen = glm::dot(m_velocities[i], m_groundNormal);
+        m_positions[i] -= m_groundNormal*penetration;
+        m_velocities[i] -= m_groundNormal*((Real(1) + m_rebound)*vPen);
+    }
+
+    inline void setGravity(const Vec3 &g) { m_gravity = g; }
+    inline void setViscosity(Real v) { m_viscosity = v; }
+    inline void setTimeStep(Real dt) { m_dt = dt; }
+    inline void setRebound(Real r) { m_rebound = r; }
+    inline void setGround(const Vec3 &pos, const Vec3 &normal) { m_groundPosition = pos; m_groundNormal = normal; }
+    inline void setCollisions(bool onOff) { m_collisions = onOff; }
+    // Explicite par défaut; l'implicite reste stable avec des ressorts
+    // raides à grand pas, au prix d'une résolution par pas
+    inline void setIntegrator(integrator_t i) { m_integrator = i; }
+    inline void setPosition(uint32_t i, const Vec3 &p) { m_positions[i] = p; }
+
+    inline integrator_t getIntegrator() const { return m_integrator; }
+    inline uint32_t getNbParticles() const { return m_positions.size(); }
+    inline uint32_t getNbSprings() const { return m_springs.size(); }
+    inline const Vec3 &getPosition(uint32_t i) const { return m_positions[i]; }
+    inline Real getRadius(uint32_t i) const { return m_radii[i]; }
+    inline uint32_t getSpringA(uint32_t s) const { return m_springs[s].a; }
+    inline uint32_t getSpringB(uint32_t s) const { return m_springs[s].b; }
+};
+
+#endif
@@ -1,10 +1,21 @@
 #include "submarine.hpp"
 #include "objManager.hpp"
 #include "viewer.hpp"
+#include "mesh.hpp"
+#include <cmath>
+#include <algorithm>
+#include "glm/gtc/matrix_transform.hpp"
+
+// haut du kiosque dans le repère du modèle (y vers le haut)
+static const glm::vec3 s_mast(-7.f, 83.f, 0.f);
 
 Submarine::Submarine() : m_model(objManager::getObj("submarine")), m_viewer(NULL),
-     m_pos(-148.f, 30.f, 0.3f), m_size(2.f, 1.f, 1.5f)
+     m_pos(-148.f, 30.f, 0.3f), m_size(2.f, 1.f, 1.5f), m_current(0.f)
 {
+    // accroché au mât et tiré vers l'arrière par le courant
+    m_flag.addCloth(s_mast + glm::vec3(0.f, FLAG_MAST, 0.f), glm::vec3(-FLAG_WIDTH, 0.f, 0.f),
+            glm::vec3(0.f, -FLAG_HEIGHT, 0.f), 24, 15, 1.f, 0.1f);
+    m_flag.setColor(glm::vec3(0.8f, 0.1f, 0.1f));
 }
 
 void Submarine::draw(int pass)
@@ -14,9 +25,32 @@ void Submarine::draw(int pass)
     glRotatef(50, 1, 0, 1);
     glTranslatef(m_pos.x, m_pos.y, m_pos.z);
     m_model.draw(pass);
+
+    glPushMatrix();
+    glTranslatef(s_mast.x, s_mast.y, s_mast.z);
+    glRotatef(-90.f, 1.f, 0.f, 0.f);
+    if (pass == PASS_NORMAL)
+        glBindTexture(GL_TEXTURE_2D, 0);
+    glColor3f(0.3f, 0.3f, 0.3f);
+    Mesh::cylinder(FLAG_MAST, 1.f, 8).draw();
+    glPopMatrix();
+    m_flag.draw(pass);
     glPopMatrix();
 }
 
+bool Submarine::getBoundingSphere(glm::vec3 &center, float &radius) const
+{
+    // origine du modèle après les transformations de draw
+    glm::mat4 m(glm::rotate(glm::mat4(), 50.f, glm::vec3(1.f, 0.f, 1.f)));
+    center = glm::vec3(m*glm::vec4(m_pos, 1.f));
+    radius = std::max(m_model.getOriginRadius(),
+            glm::length(s_mast) + FLAG_MAST + FLAG_WIDTH + FLAG_HEIGHT);
+    return true;
+}
+
 void Submarine::animate()
 {
+    m_current += 0.1f;
+    m_flag.setAcceleration(glm::vec3(-40.f, -3.f, 15.f*sin(m_current)));
+    m_flag.update();
 }
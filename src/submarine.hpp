@@ -9,8 +9,13 @@
  ******************************************************************************/
 
 #include "objReader.hpp"
+#include "pbdSystem.hpp"
 #include "glm/vec3.hpp"
 
+#define FLAG_MAST 25.f // hauteur du mât au dessus du kiosque
+#define FLAG_WIDTH 30.f
+#define FLAG_HEIGHT 18.f
+
 class Viewer;
 
 class Submarine : public Renderable {
@@ -19,10 +24,14 @@ class Submarine : public Renderable {
         Viewer *m_viewer;
         glm::vec3 m_pos,
                   m_size;
+        PBDSystem m_flag; // dans le repère du modèle
+        float m_current; // phase du courant qui agite le drapeau
 
     public:
         Submarine();
         void draw(int pass);
+        // avec le mât et le drapeau
+        bool getBoundingSphere(glm::vec3 &center, float &radius) const;
         void animate();
         inline virtual void init(Viewer& v) {m_viewer = &v;};
 
@@ -0,0 +1,231 @@
+#include "terrainTiles.hpp"
+#include "viewer.hpp"
+#include "profiler.hpp"
+#include <QMutexLocker>
+#include <QThread>
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+
+#define TILES_UPLOADS_PER_FRAME 2 // tuiles récupérées au plus par frame
+
+TerrainTiles::Job::Job(TerrainTiles &owner, NoiseTerrain *tile, int generation) :
+    m_owner(owner), m_tile(tile), m_generation(generation),
+    m_w(owner.m_w), m_h(owner.m_h), m_zoom(owner.m_zoom),
+    m_persistence(owner.m_persistence), m_octaves(owner.m_octaves)
+{}
+
+void TerrainTiles::Job::run()
+{
+    // les paramètres ont changé depuis la demande: inutile de générer
+    if (m_generation == (int)m_owner.m_generation) {
+        PROFILE_SCOPE("generate tile");
+        m_tile->generateClouds(m_w, m_h, m_zoom, m_persistence, m_octaves);
+        m_tile->releaseCache();
+    }
+    m_owner.finished(m_tile, m_generation);
+}
+
+TerrainTiles::TerrainTiles(NoiseTerrain *center) :
+    m_center(center), m_viewer(NULL), m_frame(0),
+    m_w(0), m_h(0), m_zoom(0), m_persistence(0), m_octaves(0),
+    m_generation(0)
+{
+    // on laisse un coeur au thread de l'interface
+    m_pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()-1));
+}
+
+TerrainTiles::~TerrainTiles()
+{
+    m_generation.ref();
+    m_pool.waitForDone();
+    flush();
+    for (std::list<std::pair<NoiseTerrain*, int> >::iterator it(m_done.begin()); it != m_done.end(); ++it)
+        delete it->first;
+    // après les tuiles, qui partagent ses indices
+    delete m_center;
+}
+
+void TerrainTiles::init(Viewer &v)
+{
+    m_viewer = &v;
+    m_center->init(v);
+}
+
+void TerrainTiles::setParameters(uint32_t w, uint32_t h, double zoom, double persistence, int octaves)
+{
+    // les jobs en cours lisent ces valeurs: on invalide d'abord la génération,
+    // un job qui a déjà commencé sera jeté à la récupération
+    m_generation.ref();
+    m_w = w;
+    m_h = h;
+    m_zoom = zoom;
+    m_persistence = persistence;
+    m_octaves = octaves;
+    flush();
+}
+
+void TerrainTiles::flush()
+{
+    for (std::map<key_t, tile_t>::iterator it(m_tiles.begin()); it != m_tiles.end(); ++it)
+        delete it->second.terrain;
+    m_tiles.clear();
+    m_pending.clear();
+}
+
+void TerrainTiles::finished(NoiseTerrain *tile, int generation)
+{
+    QMutexLocker lock(&m_doneMutex);
+    m_done.push_back(std::make_pair(tile, generation));
+}
+
+void TerrainTiles::collect()
+{
+    // si un thread est en train de rendre une tuile on réessaiera à la
+    // prochaine frame
+    if (!m_doneMutex.tryLock())
+        return;
+    std::list<std::pair<NoiseTerrain*, int> > done;
+    for (uint32_t i = 0; i < TILES_UPLOADS_PER_FRAME && !m_done.empty(); i++) {
+        done.push_back(m_done.front());
+        m_done.pop_front();
+    }
+    m_doneMutex.unlock();
+
+    for (std::list<std::pair<NoiseTerrain*, int> >::iterator it(done.begin()); it != done.end(); ++it) {
+        NoiseTerrain *t = it->first;
+        if (it->second != (int)m_generation) {
+            delete t;
+            continue;
+        }
+        key_t k(t->getTileX(), t->getTileY());
+        m_pending.erase(k);
+        tile_t &tile = m_tiles[k];
+        tile.terrain = t;
+        tile.lastUsed = m_frame;
+    }
+}
+
+void TerrainTiles::request(int32_t cx, int32_t cy)
+{
+    NoiseTerrain *t = new NoiseTerrain();
+    t->setTile(cx, cy);
+    t->shareIndices(m_center);
+    if (m_viewer)
+        t->init(*m_viewer);
+    m_pending.insert(key_t(cx, cy));
+    m_pool.start(new Job(*this, t, m_generation));
+}
+
+TerrainTiles::key_t TerrainTiles::tileAt(float x, float y) const
+{
+    if (m_w == 0)
+        return key_t(0, 0);
+    return key_t((int32_t)floor((x + TERRAIN_WIDTH/2.f)/tileWidth()),
+                 (int32_t)floor((y + TERRAIN_HEIGHT/2.f)/tileHeight()));
+}
+
+NoiseTerrain *TerrainTiles::getTile(const key_t &k)
+{
+    if (k.first == 0 && k.second == 0)
+        return m_center;
+    std::map<key_t, tile_t>::iterator it(m_tiles.find(k));
+    return it != m_tiles.end() ? it->second.terrain : NULL;
+}
+
+void TerrainTiles::getZ(const float *x, const float *y, float *z, glm::vec3 *normals, uint32_t count)
+{
+    // points triés par tuile, puis une requête par tuile
+    m_query.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+        m_query[i] = std::make_pair(tileAt(x[i], y[i]), i);
+    std::sort(m_query.begin(), m_query.end());
+
+    for (uint32_t begin = 0, end = 0; begin < count; begin = end) {
+        const key_t k(m_query[begin].first);
+        for (end = begin+1; end < count && m_query[end].first == k; end++);
+        NoiseTerrain *t = getTile(k);
+        if (!t)
+            continue;
+        const uint32_t n = end - begin;
+        m_queryX.resize(n);
+        m_queryY.resize(n);
+        m_queryZ.resize(n);
+        if (normals)
+            m_queryNormals.resize(n);
+        for (uint32_t i = 0; i < n; i++) {
+            m_queryX[i] = x[m_query[begin+i].second];
+            m_queryY[i] = y[m_query[begin+i].second];
+        }
+        t->getZ(&m_queryX[0], &m_queryY[0], &m_queryZ[0], normals ? &m_queryNormals[0] : NULL, n);
+        for (uint32_t i = 0; i < n; i++) {
+            z[m_query[begin+i].second] = m_queryZ[i];
+            if (normals)
+                normals[m_query[begin+i].second] = m_queryNormals[i];
+        }
+    }
+}
+
+void TerrainTiles::update()
+{
+    if (!m_viewer || m_w == 0)
+        return;
+    m_frame++;
+    collect();
+
+    // tuile sous la caméra
+    qglviewer::Vec eye(m_viewer->camera()->position());
+    key_t center(tileAt(eye.x, eye.y));
+    int32_t cx = center.first, cy = center.second;
+
+    // demandes de la plus proche à la plus éloignée, sans trop en empiler
+    // pour que les tuiles proches restent prioritaires quand on bouge
+    const uint32_t maxPending = 2*m_pool.maxThreadCount();
+    for (int32_t r = 0; r <= TILES_RADIUS; r++) {
+        for (int32_t y = cy-r; y <= cy+r; y++) {
+            for (int32_t x = cx-r; x <= cx+r; x++) {
+                if (std::max(std::abs(x-cx), std::abs(y-cy)) != r)
+                    continue;
+                key_t k(x, y);
+                if (x == 0 && y == 0)
+                    continue;
+                std::map<key_t, tile_t>::iterator it(m_tiles.find(k));
+                if (it != m_tiles.end())
+                    it->second.lastUsed = m_frame;
+                else if (m_pending.size() < maxPending && !m_pending.count(k))
+                    request(x, y);
+            }
+        }
+    }
+
+    evict(cx, cy);
+}
+
+// éviction des tuiles trop loin de (cx, cy), puis des moins récemment utilisées
+void TerrainTiles::evict(int32_t cx, int32_t cy)
+{
+    std::map<key_t, tile_t>::iterator oldest(m_tiles.end());
+    for (std::map<key_t, tile_t>::iterator it(m_tiles.begin()); it != m_tiles.end();) {
+        if (std::max(std::abs(it->first.first-cx), std::abs(it->first.second-cy)) > TILES_KEEP_RADIUS) {
+            delete it->second.terrain;
+            m_tiles.erase(it++);
+            continue;
+        }
+        if (oldest == m_tiles.end() || it->second.lastUsed < oldest->second.lastUsed)
+            oldest = it;
+        ++it;
+    }
+    if (m_tiles.size() > TILES_MAX) {
+        delete oldest->second.terrain;
+        m_tiles.erase(oldest);
+    }
+}
+
+void TerrainTiles::draw(int pass)
+{
+    if (pass == PASS_NORMAL)
+        update();
+    m_center->draw(pass);
+    for (std::map<key_t, tile_t>::iterator it(m_tiles.begin()); it != m_tiles.end(); ++it)
+        it->second.terrain->draw(pass);
+}
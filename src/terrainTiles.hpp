@@ -0,0 +1,116 @@
+#ifndef __TERRAINTILES_H__
+#define __TERRAINTILES_H__
+/*******************************************************************************
+ *  TerrainTiles                                                               *
+ *  Mon Jun 02 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include "renderable.hpp"
+#include "NoiseTerrain.hpp"
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QAtomicInt>
+#include <map>
+#include <set>
+#include <list>
+#include <utility>
+#include <vector>
+
+#define TILES_RADIUS 2 // tuiles chargées autour de celle de la caméra
+#define TILES_KEEP_RADIUS (TILES_RADIUS+1) // hystérésis avant l'éviction
+#define TILES_MAX 32 // tuiles résidentes au maximum (LRU)
+
+// Terrain infini: la tuile (0,0) est le NoiseTerrain de la scène, les autres
+// sont générées par des threads en arrière plan quand la caméra s'approche.
+// Le thread de l'interface ne fait que récupérer les tuiles terminées (sans
+// jamais attendre un verrou) et envoyer leurs buffers à OpenGL.
+class TerrainTiles : public Renderable {
+    typedef std::pair<int32_t, int32_t> key_t;
+
+    struct tile_t {
+        NoiseTerrain *terrain;
+        uint32_t lastUsed; // numéro de la dernière frame où la tuile a servi
+    };
+
+    // génère une tuile dans un thread du pool
+    class Job : public QRunnable {
+        TerrainTiles &m_owner;
+        NoiseTerrain *m_tile;
+        int m_generation;
+        // copie des paramètres, qui peuvent changer pendant la génération
+        uint32_t m_w, m_h;
+        double m_zoom, m_persistence;
+        int m_octaves;
+    public:
+        Job(TerrainTiles &owner, NoiseTerrain *tile, int generation);
+        void run();
+    };
+
+    NoiseTerrain *m_center;
+    Viewer *m_viewer;
+    QThreadPool m_pool;
+
+    std::map<key_t, tile_t> m_tiles;
+    std::set<key_t> m_pending; // tuiles demandées au pool
+    uint32_t m_frame;
+
+    // paramètres du bruit, identiques pour toutes les tuiles
+    uint32_t m_w, m_h;
+    double m_zoom, m_persistence;
+    int m_octaves;
+    // incrémenté à chaque changement de paramètres, les tuiles d'une
+    // génération précédente sont jetées
+    QAtomicInt m_generation;
+
+    // tuiles terminées par les threads, protégées par m_doneMutex
+    QMutex m_doneMutex;
+    std::list<std::pair<NoiseTerrain*, int> > m_done;
+
+    // tampons de getZ, gardés entre deux appels
+    std::vector<std::pair<key_t, uint32_t> > m_query;
+    std::vector<float> m_queryX, m_queryY, m_queryZ;
+    std::vector<glm::vec3> m_queryNormals;
+
+    void finished(NoiseTerrain *tile, int generation);
+    // tuile qui contient le point (x,y) du monde
+    key_t tileAt(float x, float y) const;
+    // NULL si la tuile n'est pas chargée
+    NoiseTerrain *getTile(const key_t &k);
+    // récupère les tuiles finies, demande les manquantes, évince les vieilles
+    void update();
+    void collect();
+    void request(int32_t cx, int32_t cy);
+    // autour de la tuile (cx, cy), au plus TILES_MAX tuiles gardées
+    void evict(int32_t cx, int32_t cy);
+    void flush();
+
+public:
+    // center est détruit avec les tuiles
+    TerrainTiles(NoiseTerrain *center);
+    ~TerrainTiles();
+
+    void init(Viewer &v);
+    void draw(int pass);
+
+    // mêmes paramètres que NoiseTerrain::generateClouds, la tuile centrale
+    // doit déjà avoir été générée avec
+    void setParameters(uint32_t w, uint32_t h, double zoom, double persistence, int octaves);
+
+    // taille d'une tuile dans le repère du monde
+    inline float tileWidth() const { return m_w > 0 ? TERRAIN_WIDTH*(m_w-1)/m_w : TERRAIN_WIDTH; }
+    inline float tileHeight() const { return m_h > 0 ? TERRAIN_HEIGHT*(m_h-1)/m_h : TERRAIN_HEIGHT; }
+
+    // NoiseTerrain::getZ sur toutes les tuiles: chaque point est envoyé à
+    // la tuile qui le contient, par lots. Au dessus d'une tuile pas encore
+    // chargée z (et la normale) ne sont pas modifiés.
+    void getZ(const float *x, const float *y, float *z, glm::vec3 *normals, uint32_t count);
+
+    inline uint32_t getNbTiles() const { return m_tiles.size(); }
+    inline uint32_t getNbPending() const { return m_pending.size(); }
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "timeline.hpp"
+
+float Timeline::s_time = 0.f;
+std::vector<Timeline::Actor*> Timeline::s_actors;
+
+void Timeline::seek(float time)
+{
+    s_time = time < 0.f ? 0.f : time;
+    for (size_t i = 0; i < s_actors.size(); i++)
+        s_actors[i]->seek(s_time);
+}
+
+void Timeline::subscribe(Actor *a)
+{
+    s_actors.push_back(a);
+}
+
+void Timeline::unsubscribe(Actor *a)
+{
+    s_actors.erase(std::remove(s_actors.begin(), s_actors.end(), a), s_actors.end());
+}
@@ -0,0 +1,139 @@
+#ifndef __TIMELINE_H__
+#define __TIMELINE_H__
+/*******************************************************************************
+ *  Timeline                                                                   *
+ *  Fri Jun 06 CEST 2014                                                       *
+ *  Copyright Eduardo San Martin Morote                                        *
+ *  eduardo.san-martin-morote@ensimag.fr                                       *
+ *  http://posva.net                                                           *
+ ******************************************************************************/
+
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+
+#define TIMELINE_END FLT_MAX // pour les pistes qui ne s'arrêtent jamais
+
+// Piste d'états: des clés triées par instant, la valeur à l'instant t est
+// celle de la dernière clé <= t. Recherche dichotomique, O(log n).
+template <class T>
+class StepTrack {
+    std::vector<float> m_times;
+    std::vector<T> m_values;
+
+public:
+    void add(float time, const T &value)
+    {
+        size_t i = std::upper_bound(m_times.begin(), m_times.end(), time) - m_times.begin();
+        m_times.insert(m_times.begin()+i, time);
+        m_values.insert(m_values.begin()+i, value);
+    }
+
+    // indice de la dernière clé <= time, -1 s'il n'y en a pas
+    inline int find(float time) const
+    {
+        return (int)(std::upper_bound(m_times.begin(), m_times.end(), time) - m_times.begin()) - 1;
+    }
+    inline T at(float time, const T &def) const
+    {
+        int i = find(time);
+        return i < 0 ? def : m_values[i];
+    }
+
+    inline int size() const { return m_times.size(); }
+    inline bool empty() const { return m_times.empty(); }
+    inline float getTime(int i) const { return m_times[i]; }
+    inline const T& getValue(int i) const { return m_values[i]; }
+    inline const T& back() const { return m_values.back(); }
+};
+
+// Variation à vitesse constante par morceaux: add(begin, end, rate) ajoute
+// rate par tick sur [begin, end[, les morceaux peuvent se recouvrir.
+// at(t) est la variation cumulée avant t, lue depuis les sommes préfixes
+// aux changements de vitesse: pas besoin de rejouer les ticks.
+template <class T>
+class RampTrack {
+    struct knot_t {
+        float time;
+        T value, rate; // valeur en time et vitesse après
+    };
+    std::vector<std::pair<float, T> > m_changes; // changements de vitesse
+    mutable std::vector<knot_t> m_knots;
+    mutable bool m_dirty;
+
+    static bool changeBefore(const std::pair<float, T> &a, const std::pair<float, T> &b) { return a.first < b.first; }
+    static bool knotAfter(float time, const knot_t &k) { return time < k.time; }
+
+    void build() const
+    {
+        std::vector<std::pair<float, T> > changes(m_changes);
+        std::stable_sort(changes.begin(), changes.end(), changeBefore);
+        m_knots.clear();
+        T value = T(), rate = T();
+        float time = 0.f;
+        for (size_t i = 0; i < changes.size(); i++) {
+            value = value + rate*(changes[i].first - time);
+            time = changes[i].first;
+            rate = rate + changes[i].second;
+            if (!m_knots.empty() && m_knots.back().time == time) {
+                m_knots.back().rate = rate;
+            } else {
+                knot_t k;
+                k.time = time;
+                k.value = value;
+                k.rate = rate;
+                m_knots.push_back(k);
+            }
+        }
+        m_dirty = false;
+    }
+
+public:
+    RampTrack() : m_dirty(false) {}
+
+    void add(float begin, float end, const T &rate)
+    {
+        m_changes.push_back(std::make_pair(begin, rate));
+        if (end != TIMELINE_END)
+            m_changes.push_back(std::make_pair(end, T()-rate));
+        m_dirty = true;
+    }
+
+    T at(float time) const
+    {
+        if (m_dirty)
+            build();
+        typename std::vector<knot_t>::const_iterator it(std::upper_bound(m_knots.begin(), m_knots.end(), time, knotAfter));
+        if (it == m_knots.begin())
+            return T();
+        --it;
+        return it->value + it->rate*(time - it->time);
+    }
+};
+
+// Horloge de l'histoire, en ticks (fps par seconde). Les acteurs calculent
+// leur état directement à partir de l'instant courant, avec leurs pistes.
+// Ceux qui gardent un état propre entre deux ticks (simulation, effets)
+// s'abonnent pour être prévenus quand on saute à un autre instant.
+class Timeline {
+public:
+    class Actor {
+    public:
+        virtual ~Actor() {}
+        // appelé quand l'horloge saute à time
+        virtual void seek(float time) = 0;
+    };
+
+    static inline float getTime() { return s_time; }
+    static inline void tick(float dt = 1.f) { s_time += dt; }
+    static void seek(float time);
+
+    static void subscribe(Actor *a);
+    static void unsubscribe(Actor *a);
+
+private:
+    static float s_time;
+    static std::vector<Actor*> s_actors;
+};
+
+#endif
@@ -2,21 +2,21 @@
 using namespace std;
 #include "torse.hpp"
 #include "cylinder.hpp"
+#include "mesh.hpp"
 #include <cmath>
 #include "animation.hpp"
-#include "bubble.hpp"
+#include "diverRig.hpp"
+#include "bubbleBatch.hpp"
 #include "viewer.hpp"
 #include <stdlib.h>
-#include "glm/gtx/rotate_vector.hpp"
 #include "objManager.hpp"
 #include "const.hpp"
 
 Torse::Torse() :
-    m_length(4.f),
-    m_width(2.f),
-    m_headRadius(1.2f),
+    m_length(DIVER_LENGTH),
+    m_width(DIVER_WIDTH),
+    m_headRadius(DIVER_HEAD_RADIUS),
     m_precision(16),
-    m_timer(0),
     m_figure(m_length, m_width, m_precision),
     m_bottle(3.f, 1.f, m_precision),
     m_lUArm(m_precision),
@@ -27,17 +27,10 @@ Torse::Torse() :
     m_rULeg(m_precision),
     m_lLLeg(m_precision),
     m_rLLeg(m_precision),
-    m_frame(0),
     m_bubbles(0),
     m_viewer(NULL),
-    m_animSwim(new Animation(30)),
-    m_animGetUp(new Animation(30)),
-    m_animSwimTrans(new Animation(30)),
-    m_animAim(new Animation(30)),
-    m_animRecoil(new Animation(10)),
-    m_animHeadUp(new Animation(30)),
-    m_currentAnim(NULL),
     m_pos(0, -BEG_DIST, COMMON_HEIGHT),
+    m_skeleton(DiverRig::getSkeleton()),
     m_viewRpg(0),
     m_viewMissile(0),
     m_posMissile(0),
@@ -45,183 +38,139 @@ Torse::Torse() :
     m_missile(objManager::getObj("missile")),
     m_tube()
 {
-    float tmp = 10;
-    m_animSwim->addFrame(0, e_torse, glm::vec3(-90, 0, -tmp));
-    m_animSwim->addFrame(0, e_head, glm::vec3(15, 0, tmp));
-
-    m_animSwim->addFrame(0, e_legUL, glm::vec3(15, 0, 0));
-    m_animSwim->addFrame(0, e_legLL, glm::vec3(0, 0, 0));
-    m_animSwim->addFrame(0, e_legUR, glm::vec3(-15, 0, 0));
-    m_animSwim->addFrame(0, e_legLR, glm::vec3(-tmp, 0, 0));
-
-    m_animSwim->addFrame(0, e_armUL, glm::vec3(0, -75, 180));
-    m_animSwim->addFrame(0, e_armUR, glm::vec3(0, 75, 10));
-    m_animSwim->addFrame(0, e_armLL, glm::vec3(0, 0, 0));
-    m_animSwim->addFrame(0, e_armLR, glm::vec3(0, 0, 0));
-
-    m_animSwim->addFrame(14, e_torse, glm::vec3(-90, 0, tmp));
-    m_animSwim->addFrame(14, e_head, glm::vec3(15, 0, -tmp));
-    m_animSwim->addFrame(14, e_legUL, glm::vec3(-15, 0, 0));
-    m_animSwim->addFrame(14, e_legLL, glm::vec3(-tmp, 0, 0));
-    m_animSwim->addFrame(14, e_legUR, glm::vec3(15, 0, 0));
-    m_animSwim->addFrame(14, e_legLR, glm::vec3(0, 0, 0));
-    m_animSwim->addFrame(14, e_armUL, glm::vec3(0, -75, 170));
-    m_animSwim->addFrame(14, e_armUR, glm::vec3(0, 75, 0));
-
-    m_animSwim->addFrame(29, e_torse, glm::vec3(-90, 0, -tmp));
-    m_animSwim->addFrame(29, e_head, glm::vec3(15, 0, tmp));
-    m_animSwim->addFrame(29, e_legUL, glm::vec3(15, 0, 0));
-    m_animSwim->addFrame(29, e_legLL, glm::vec3(0, 0, 0));
-    m_animSwim->addFrame(29, e_legUR, glm::vec3(-15, 0, 0));
-    m_animSwim->addFrame(29, e_legLR, glm::vec3(-tmp, 0, 0));
-    m_animSwim->addFrame(29, e_armUL, glm::vec3(0, -75, 180));
-    m_animSwim->addFrame(29, e_armUR, glm::vec3(0, 75, 10));
-
-
-    // animation pour se redresser
-    m_animGetUp->addFrameFromCurrent(0);
-    m_animGetUp->addFrame(29, e_torse, glm::vec3(-5, 0, 0));
-    m_animGetUp->addFrame(29, e_head, glm::vec3(20, 0, 0));
-    m_animGetUp->addFrame(29, e_armUL, glm::vec3(0, -75, 180));
-    m_animGetUp->addFrame(29, e_armLL, glm::vec3());
-    m_animGetUp->addFrame(29, e_armUR, glm::vec3(0, 75, 10));
-    m_animGetUp->addFrame(29, e_armLR, glm::vec3());
-    m_animGetUp->addFrame(29, e_legUL, glm::vec3(0, 15, 0));
-    m_animGetUp->addFrame(29, e_legLL, glm::vec3());
-    m_animGetUp->addFrame(29, e_legUR, glm::vec3(0, -15, 0));
-    m_animGetUp->addFrame(29, e_legLR, glm::vec3());
-
-    // Animation pour se remettre à nager
-    m_animSwimTrans->addFrameFromCurrent(0);
-    m_animSwimTrans->addFrame(19, e_torse, glm::vec3(-90, 0, -tmp));
-    m_animSwimTrans->addFrame(19, e_head, glm::vec3(15, 0, tmp));
-    m_animSwimTrans->addFrame(19, e_legUL, glm::vec3(15, 0, 0));
-    m_animSwimTrans->addFrame(19, e_legLL, glm::vec3(0, 0, 0));
-    m_animSwimTrans->addFrame(19, e_legUR, glm::vec3(-15, 0, 0));
-    m_animSwimTrans->addFrame(19, e_legLR, glm::vec3(-tmp, 0, 0));
-    m_animSwimTrans->addFrame(19, e_armUL, glm::vec3(0, -75, 180));
-    m_animSwimTrans->addFrame(19, e_armUR, glm::vec3(0, 75, 10));
-    m_animSwimTrans->addFrame(19, e_armLL, glm::vec3(0, 0, 0));
-    m_animSwimTrans->addFrame(19, e_armLR, glm::vec3(0, 0, 0));
-
-    // Animation pour sortir l'arme et viser
-    m_animAim->addFrameFromCurrent(0);
-    m_animAim->addFrame(7, e_armUL, glm::vec3(10, 75, 180));
-    m_animAim->addFrame(7, e_armLL, glm::vec3(0, 0, 0));
-    m_animAim->addFrame(13, e_armUL, glm::vec3(10, 75, 180));
-    m_animAim->addFrame(13, e_armLL, glm::vec3(0, 0, 90));
-    m_animAim->addFrame(19, e_armUL, glm::vec3(-90, 75, 180));
-    m_animAim->addFrame(19, e_armLL, glm::vec3(0, 0, 90));
-    m_animAim->addFrame(19, e_armUR, glm::vec3(-30, 75, 180));
-    m_animAim->addFrame(19, e_armLR, glm::vec3(0, 45, 0));
-    m_animAim->addFrame(15, e_torse);
-    m_animAim->addFrame(19, e_torse, glm::vec3(0, 0, -10));
-
-    // Animation pour le recul apres le coup de feu
-    m_animRecoil->addFrameFromCurrent(0);
-    m_animRecoil->addFrame(9, e_legUL, glm::vec3(75, 35, 0));
-    m_animRecoil->addFrame(9, e_legUR, glm::vec3(75, -35, 0));
+    // L'histoire du plongeur, en ticks. Les bornes sont celles des anciens
+    // tests sur le timer: la nage avance jusqu'à 4s, reprend entre 7s et 9s,
+    // puis il lève la tête, se redresse, vise et tire. Une animation lancée
+    // dans le même tick qu'elle avance commence à 1.
+    m_story.play(0, DiverRig::getClip(DiverRig::e_swim), 1);
+    m_story.pause(fps*4);
+    m_story.resume(fps*7+1);
+    m_story.pause(fps*9);
+    m_story.play(fps*9+1, DiverRig::getClip(DiverRig::e_headUp), 1);
+    m_story.pause(fps*10);
+    m_story.play(fps*20+1, DiverRig::getClip(DiverRig::e_getUp), 1);
+    m_story.pause(fps*21);
+    const float aim = fps*23+1;
+    m_story.play(aim, DiverRig::getClip(DiverRig::e_aim));
+    m_story.pause(fps*24);
+    m_story.resume(fps*24+1);
+    // chaque animation enchaîne sur la suivante quand elle se termine
+    const float recoil = m_story.end();
+    m_story.play(recoil, DiverRig::getClip(DiverRig::e_recoil));
+    const float swimTrans = m_story.end();
+    m_story.play(swimTrans, DiverRig::getClip(DiverRig::e_swimTrans));
+    m_story.play(m_story.end(), DiverRig::getClip(DiverRig::e_swim));
+
+    m_move.add(0, fps*4, glm::vec3(0, SWIM_SPD, 0));
+    m_move.add(fps*7+1, fps*9, glm::vec3(0, SWIM_SPD, 0));
+    // recule pendant la visée, y compris le tick où elle se termine
+    m_move.add(fps*24+1, recoil+1, glm::vec3(0, -0.3, 0));
+    m_move.add(recoil+1, TIMELINE_END, glm::vec3(0, SWIM_SPD, 0));
+
+    // l'arme sort à la frame 13 de la visée, le missile part au recul
+    m_rpgTrack.add(aim+13, 1);
+    m_missileTrack.add(aim+13, 1);
+    m_missileTrack.add(swimTrans, 0);
+    m_missileMove.add(recoil, swimTrans, 1.f);
+
+    Timeline::subscribe(this);
+    seek(Timeline::getTime());
+}
 
-    // ANimation pour lever la tête face au requin
-    // Animation pour le recul apres le coup de feu
-    m_animHeadUp->addFrameFromCurrent(0);
-    m_animHeadUp->addFrame(29, e_head, glm::vec3(35, 0, 0));
+Torse::~Torse()
+{
+    Timeline::unsubscribe(this);
+}
 
-    setAnimation(m_animSwim);
-    animate();// otherwise it all angs are at 0
+void Torse::evaluate(float time)
+{
+    // état après le tick time
+    m_story.pose(time, m_pose);
+    m_pos = glm::vec3(0, -BEG_DIST, COMMON_HEIGHT) + m_move.at(time+1);
+    m_viewRpg = m_rpgTrack.at(time, 0);
+    m_viewMissile = m_missileTrack.at(time, 0);
+    m_posMissile = m_missileMove.at(time+1);
+    updatePose();
+}
 
-    m_tube.init(Vec(getHeadPos()));
+void Torse::updatePose()
+{
+    m_skeleton.setOffset(DiverRig::j_torse, m_pos);
+    for (int i = 0; i < e_frame_type_count; i++)
+        m_skeleton.setRotation(DiverRig::getJoint((frame_type)i), m_pose[i]);
+    m_skeleton.update();
 
+    m_headPos = m_skeleton.getPosition(DiverRig::j_head);
+    m_lookAt = glm::vec3(m_skeleton.getWorld(DiverRig::j_torse)[1]);
 }
 
-void Torse::setAnimation(Animation* a)
+void Torse::seek(float time)
 {
-    m_currentAnim = a;
-    a->generateInterpolation(*this);
-    m_frame = 0;
+    evaluate(time);
+    // le tuyau est simulé, on le replace simplement
+    m_tube.init(Vec(getHeadPos()));
+    m_bubbles = 0;
 }
 
 void Torse::draw(int pass)
 {
-    glPushMatrix();
     if (pass == PASS_NORMAL)
         glBindTexture(GL_TEXTURE_2D, 0);
 
-    glTranslatef(m_pos.x, m_pos.y, m_pos.z);
-
-    //glRotatef(45, 0, 1, 0);
-    //glRotatef(45, 1, 0, 0);
-    //glRotatef(45, 0, 0, 1);
-    //glRotatef(m_tmp, 1, 1, 1);
-    glRotatef(m_angTorse.x, 1, 0, 0);
-    glRotatef(m_angTorse.y, 0, 1, 0);
-    glRotatef(m_angTorse.z, 0, 0, 1);
-
-    // Torse
+    glPushMatrix();
+    m_skeleton.load(DiverRig::j_torse);
+    // un diver loin de la caméra est dessiné avec moins de faces
+    int lod = 0;
+    if (m_viewer) {
+        qglviewer::Vec eye(m_viewer->camera()->position());
+        lod = Mesh::levelOfDetail(glm::length(glm::vec3(eye.x, eye.y, eye.z) - m_pos));
+    }
     glColor3f(152/255.0f,87/255.0f,23/255.0f);
-    m_figure.draw(pass);
+    m_figure.draw(pass, lod);
+    glPopMatrix();
 
     // Bottle
     glPushMatrix();
-    glTranslatef(0, -1.3f, 0.1f);
+    m_skeleton.load(DiverRig::j_bottle);
     glColor3f(237/255.0f,255/255.0f,12/255.0f);
-    m_bottle.draw(pass);
+    m_bottle.draw(pass, lod);
     glPopMatrix();
 
     glPushMatrix();
-    glTranslatef(0, 0, m_length);
-    //glTranslatef(0, m_headRadius, m_headRadius);
-    glRotatef(m_angHead.x, 1, 0, 0);
-    glRotatef(m_angHead.y, 0, 1, 0);
-    glRotatef(m_angHead.z, 0, 0, 1);
+    m_skeleton.load(DiverRig::j_head);
     glColor3f(175/255.0f,175/255.0f,175/255.0f);
-    glutSolidSphere(m_headRadius, m_precision, m_precision);
+    Mesh::sphere(m_headRadius, m_precision, m_precision, lod).draw();
     glPopMatrix();
 
     //Right arm
     glPushMatrix();
-    glTranslatef(m_width/2.0*1.1, 0, m_length*0.80);
-    glRotatef(m_angURArm.x, 1, 0, 0);
-    glRotatef(m_angURArm.y, 0, 1, 0);
-    glRotatef(m_angURArm.z, 0, 0, 1);
-    //glColor3f(0,0,1);
+    m_skeleton.load(DiverRig::j_armUR);
     glColor3f(237/255.0f,255/255.0f,12/255.0f);
-    m_rUArm.draw(pass);
+    m_rUArm.draw(pass, lod);
+    glPopMatrix();
 
-    glTranslatef(m_rUArm.getLength(), 0, 0);
-    glRotatef(m_angLRArm.x, 1, 0, 0);
-    glRotatef(m_angLRArm.y, 0, 1, 0);
-    glRotatef(m_angLRArm.z, 0, 0, 1);
-    //glColor3f(1,0,0);
+    glPushMatrix();
+    m_skeleton.load(DiverRig::j_armLR);
     glColor3f(175/255.0f,175/255.0f,175/255.0f);
-    m_rLArm.draw(pass);
-
+    m_rLArm.draw(pass, lod);
     glPopMatrix();
 
     //Left arm
     glPushMatrix();
-    glTranslatef(-(m_width/2.0*1.1), 0, m_length*0.80);
-    glRotatef(m_angULArm.x, 1, 0, 0);
-    glRotatef(m_angULArm.y, 0, 1, 0);
-    glRotatef(m_angULArm.z, 0, 0, 1);
-    //glColor3f(0,0,1);
+    m_skeleton.load(DiverRig::j_armUL);
     glColor3f(237/255.0f,255/255.0f,12/255.0f);
-    m_lUArm.draw(pass);
+    m_lUArm.draw(pass, lod);
+    glPopMatrix();
 
-    glTranslatef(m_lUArm.getLength(), 0, 0);
-    glRotatef(m_angLLArm.x, 1, 0, 0);
-    glRotatef(m_angLLArm.y, 0, 1, 0);
-    glRotatef(m_angLLArm.z, 0, 0, 1);
-    //glColor3f(1,0,0);
+    glPushMatrix();
+    m_skeleton.load(DiverRig::j_armLL);
     glColor3f(175/255.0f,175/255.0f,175/255.0f);
-    m_lLArm.draw(pass);
+    m_lLArm.draw(pass, lod);
+    glPopMatrix();
 
     //Weapon
     glPushMatrix();
-    glTranslatef(m_lUArm.getLength(), 0, 0);
-    glRotatef(90, 1, 0, 0);
-    glRotatef(-53, 0, 1, 0);
-    glRotatef(-90, 0, 0, 1);
+    m_skeleton.load(DiverRig::j_weapon);
     glScalef(3.0f, 3.0f, 3.0f);
     if (m_viewRpg == 1){
         glColor3f(1.f, 1.f, 1.f);
@@ -237,207 +186,62 @@ void Torse::draw(int pass)
     glBindTexture(GL_TEXTURE_2D, 0);
     glPopMatrix();
 
-    glPopMatrix();
-
     //Right leg
     glPushMatrix();
-    glTranslatef(m_width/2.0*0.7, 0, 0.0);
-    glRotatef(m_angURLeg.x, 1, 0, 0);
-    glRotatef(m_angURLeg.y, 0, 1, 0);
-    glRotatef(m_angURLeg.z, 0, 0, 1);
-    //glColor3f(0,0,1);
+    m_skeleton.load(DiverRig::j_legUR);
     glColor3f(118/255.0f,32/255.0f,1/255.0f);
-    m_rULeg.draw(pass);
+    m_rULeg.draw(pass, lod);
+    glPopMatrix();
 
-    glTranslatef(0.0, 0.0, -m_rULeg.getLength());
-    glRotatef(m_angLRLeg.x, 1, 0, 0);
-    glRotatef(m_angLRLeg.y, 0, 1, 0);
-    glRotatef(m_angLRLeg.z, 0, 0, 1);
-    //glColor3f(1,0,0);
+    glPushMatrix();
+    m_skeleton.load(DiverRig::j_legLR);
     glColor3f(175/255.0f,175/255.0f,175/255.0f);
-    m_rLLeg.draw(pass);
+    m_rLLeg.draw(pass, lod);
+    glPopMatrix();
 
-    glTranslatef(0.0, 0.0, -m_rLLeg.getLength());
-    glTranslatef(0.0, 0.5, 0.0);
-    glRotatef(-60, 1, 0, 0);
+    glPushMatrix();
+    m_skeleton.load(DiverRig::j_finR);
     m_rFin.draw(pass);
-
     glPopMatrix();
 
     //Left leg
     glPushMatrix();
-    glTranslatef(-(m_width/2.0*0.7), 0, 0);
-    glRotatef(m_angULLeg.x, 1, 0, 0);
-    glRotatef(m_angULLeg.y, 0, 1, 0);
-    glRotatef(m_angULLeg.z, 0, 0, 1);
-    //glColor3f(0,0,1);
+    m_skeleton.load(DiverRig::j_legUL);
     glColor3f(118/255.0f,32/255.0f,1/255.0f);
-    m_lULeg.draw(pass);
+    m_lULeg.draw(pass, lod);
+    glPopMatrix();
 
-    glTranslatef(0, 0, -m_lULeg.getLength());
-    glRotatef(m_angLLLeg.x, 1, 0, 0);
-    glRotatef(m_angLLLeg.y, 0, 1, 0);
-    glRotatef(m_angLLLeg.z, 0, 0, 1);
-    //glColor3f(1,0,0);
+    glPushMatrix();
+    m_skeleton.load(DiverRig::j_legLL);
     glColor3f(175/255.0f,175/255.0f,175/255.0f);
-    m_lLLeg.draw(pass);
-    
-    glTranslatef(0.0, 0.0, -m_rLLeg.getLength());
-    glTranslatef(0.0, 0.5, 0.0);
-    glRotatef(-60, 1, 0, 0);
-    m_lFin.draw(pass);
-
+    m_lLLeg.draw(pass, lod);
     glPopMatrix();
 
+    glPushMatrix();
+    m_skeleton.load(DiverRig::j_finL);
+    m_lFin.draw(pass);
     glPopMatrix();
-    m_tube.draw(pass);
-}
 
-const glm::vec3& Torse::getCurrentRotation(frame_type t)
-{
-    switch(t) {
-        case e_armUL:
-            return m_angULArm;
-            break;
-        case e_armLL:
-            return m_angLLArm;
-            break;
-        case e_armUR:
-            return m_angURArm;
-            break;
-        case e_armLR:
-            return m_angLRArm;
-            break;
-        case e_legUL:
-            return m_angULLeg;
-            break;
-        case e_legLL:
-            return m_angLLLeg;
-            break;
-        case e_legUR:
-            return m_angURLeg;
-            break;
-        case e_legLR:
-            return m_angLRLeg;
-            break;
-        case e_head:
-            return m_angHead;
-            break;
-        case e_torse:
-            return m_angTorse;
-            break;
-        default:
-            break;
-    }
-    return m_angULArm;
+    m_tube.draw(pass);
 }
 
 void Torse::animate()
 {
-    m_currentAnim->update(*this, m_frame);
-    if (m_timer < fps*4) {
-        m_pos.y += SWIM_SPD;
-        m_frame = m_frame == m_currentAnim->getSize()-1?0: m_frame+1;
-    } else if (m_timer > fps*7 && m_timer < fps*9) {
-        m_pos.y += SWIM_SPD;
-        m_frame = m_frame == m_currentAnim->getSize()-1?0: m_frame+1;
-    } else if (m_timer < fps*10 && m_timer > fps*9) {
-        if (m_currentAnim != m_animHeadUp)
-            setAnimation(m_animHeadUp);
-        m_frame = m_frame == m_currentAnim->getSize()-1?0: m_frame+1;
-    } else if (m_timer > 20*fps && m_timer < 21*fps) {
-        if (m_currentAnim != m_animGetUp)
-            setAnimation(m_animGetUp);
-        m_frame = m_frame == m_currentAnim->getSize()-1?0: m_frame+1;
-    } else if (m_timer < 24*fps && m_timer > 23*fps) {
-        m_frame = m_frame == m_currentAnim->getSize()-1?0: m_frame+1;
-        if (m_currentAnim != m_animAim)
-            setAnimation(m_animAim);
-    } else if (m_timer > 24*fps) {
-        m_frame = m_frame == m_currentAnim->getSize()-1?0: m_frame+1;
-        if (m_currentAnim == m_animAim) {
-            m_pos.y -= 0.3;
-        } else {
-            m_pos.y += SWIM_SPD;
-        }
-        if (m_frame == 0) {
-            if (m_currentAnim == m_animAim) {
-                setAnimation(m_animRecoil);
-            } else if (m_currentAnim == m_animRecoil) {
-                setAnimation(m_animSwimTrans);
-            } else if (m_currentAnim == m_animSwimTrans) {
-                setAnimation(m_animSwim);
-            }
-        }
-    }
-
-    m_timer++;
-    if (m_frame == 13 && m_currentAnim == m_animAim) {
-        m_viewMissile = 1;
-        m_viewRpg = 1;
-    }
-    if (m_currentAnim == m_animRecoil) {
-        m_posMissile += 1.0f;
-    }
-    if (m_currentAnim == m_animSwimTrans) {
-        m_viewMissile = 0;
-    }
-    //if (m_frame == 0){
-        //// XXX TESTING
-        //if(m_currentAnim == m_animSwim)
-            //setAnimation(m_animGetUp);
-        //else if (m_currentAnim == m_animGetUp)
-            //setAnimation(m_animAim);
-        //else if (m_currentAnim == m_animAim) {
-            //setAnimation(m_animRecoil);
-        //}
-        //else if (m_currentAnim == m_animRecoil)
-            //setAnimation(m_animSwimTrans);
-        //else if (m_currentAnim == m_animSwimTrans)
-            //setAnimation(m_animSwim);
-    //}
-
+    evaluate(Timeline::getTime());
 
     m_bubbles++;
     if (m_bubbles >= 20*2) {
         m_bubbles = 0;
-        glm::vec3 pos(0, 0, m_length);
-        pos = glm::rotateX(pos, m_angTorse.x);
-        pos = glm::rotateY(pos, m_angTorse.y);
-        pos = glm::rotateZ(pos, m_angTorse.z);
+        glm::vec3 pos(m_headPos - m_pos);
         int nb_bubbles = random() % 7 +1;
         for (int i = 0; i < nb_bubbles; i++)
-            m_viewer->addRenderable(new Bubble(0.0065*(rand()%40),
-                        m_pos.x + pos.x + (random()%10)*0.1f,
+            m_viewer->bubbles->add(0.0065*(rand()%40),
+                    glm::vec3(m_pos.x + pos.x + (random()%10)*0.1f,
                         m_pos.y + pos.y + (random()%10)*0.1f,
                         m_pos.z + pos.z + (random()%10)*0.1f));
     }
     m_tube.setBeginingPosition(Vec(getHeadPos()));
-    glm::vec3 pos(0.f, 0, m_length-1.3);
-    pos = glm::rotateX(pos, m_angTorse.x);
-    pos = glm::rotateY(pos, m_angTorse.y);
-    pos = glm::rotateZ(pos, m_angTorse.z);
-    pos += m_pos;
-    m_tube.setEndPosition(Vec(pos));
+    m_tube.setEndPosition(Vec(m_skeleton.transform(DiverRig::j_torse, glm::vec3(0.f, 0, m_length-1.3))));
     m_tube.setEndParticlePosition(Vec(getHeadPos()));
     m_tube.animate();
 }
-
-glm::vec3 Torse::getHeadPos()
-{
-    glm::vec3 pos(0, 0, m_length);
-    pos = glm::rotateX(pos, m_angTorse.x);
-    pos = glm::rotateY(pos, m_angTorse.y);
-    pos = glm::rotateZ(pos, m_angTorse.z);
-    return m_pos + pos;
-}
-
-glm::vec3 Torse::getLookAt()
-{
-    glm::vec3 dir(0, 1, 0);
-    dir = glm::rotateX(dir, m_angTorse.x);
-    dir = glm::rotateY(dir, m_angTorse.y);
-    dir = glm::rotateZ(dir, m_angTorse.z);
-    return dir;
-}
-
@@ -12,27 +12,29 @@
 #endif
 #include "globals.hpp"
 #include "glm/vec3.hpp"
+#include "skeleton.hpp"
+#include "animation.hpp"
+#include "timeline.hpp"
 #include "fin.hpp"
 #include "objReader.hpp"
 #include "dynamicSystem.hpp"
 
-class Animation;
-
-class Torse : public Renderable
+class Torse : public Renderable, public Timeline::Actor
 {
     public:
-        friend class Animation;
         void draw(int pass);
         virtual void animate();
         Torse();
+        ~Torse();
+        void seek(float time);
 
         inline float getWidth() const { return m_width; }
         inline float getLength() const { return m_length; }
-        const glm::vec3& getCurrentRotation(frame_type);
-        inline void setPosition(const glm::vec3 &p) { m_pos = p; }
+        inline const glm::vec3& getCurrentRotation(frame_type t) const { return m_pose[t]; }
+        inline void setPosition(const glm::vec3 &p) { m_pos = p; updatePose(); }
         inline virtual void init(Viewer& v) {m_viewer = &v;};
-        glm::vec3 getHeadPos();
-        glm::vec3 getLookAt();
+        inline const glm::vec3& getHeadPos() const { return m_headPos; }
+        inline const glm::vec3& getLookAt() const { return m_lookAt; }
     private:
         // Values for sizing the body
         // Lengths
@@ -40,7 +42,6 @@ class Torse : public Renderable
               m_width, // size of the memebers eg: radius as they're cylinders
               m_headRadius;
         int m_precision; // number of faces
-        uint32_t m_timer;
 
 DynamicSystem m_syst;
 
@@ -59,33 +60,29 @@ DynamicSystem m_syst;
             m_rFin;
         DynamicSystem m_tube;
 
-        uint32_t m_frame, m_bubbles;
+        uint32_t m_bubbles;
         Viewer *m_viewer;
 
-        // rotation actuelles
-        glm::vec3 m_angULArm,
-                  m_angLLArm,
-                  m_angURArm,
-                  m_angLRArm,
-                  m_angULLeg,
-                  m_angLLLeg,
-                  m_angURLeg,
-                  m_angLRLeg,
-                  m_angHead,
-                  m_angTorse;
-
-        Animation *m_animSwim,
-                  *m_animGetUp,
-                  *m_animSwimTrans,
-                  *m_animAim,
-                  *m_animRecoil,
-                  *m_animHeadUp;
-
-        Animation *m_currentAnim;
+        // rotations actuelles, indexées par frame_type
+        glm::vec3 m_pose[e_frame_type_count];
+
+        // histoire du plongeur, cf Timeline
+        AnimationTrack m_story;
+        RampTrack<glm::vec3> m_move;
+        StepTrack<int> m_rpgTrack, m_missileTrack;
+        RampTrack<float> m_missileMove;
 
         glm::vec3 m_pos;
 
-        void setAnimation(Animation* a);
+        // copie du squelette de DiverRig avec la pose de ce plongeur
+        Skeleton m_skeleton;
+        glm::vec3 m_headPos, m_lookAt;
+
+        // recalcule les matrices du squelette depuis les rotations actuelles
+        void updatePose();
+
+        // pose, position et arme au tick time
+        void evaluate(float time);
 
 
         objReader& m_rpg;
@@ -13,7 +13,7 @@
 #include "chest.hpp"
 #include "submarine.hpp"
 #include "stone.hpp"
-#include "bubble.hpp"
+#include "bubbleBatch.hpp"
 #include "shark.hpp"
 #include "glm/gtx/noise.hpp"
 #include "skybox.hpp"
@@ -22,12 +22,17 @@
 #include "dynamicSystem.hpp"
 #include "cameraAnimation.hpp"
 #include "coral.hpp"
+#include "reef.hpp"
+#include "crowd.hpp"
+#include "timeline.hpp"
 #include "globals.hpp"
 #include "const.hpp"
+#include "profiler.hpp"
 #include <sstream>
+#include <cmath>
 #include <ctime>
 
-Viewer::Viewer() : currentCaustic(0), useCustomCamera(false), useCaustics(true), flock(NULL)
+Viewer::Viewer() : currentCaustic(0), useCustomCamera(false), useCaustics(true), singlePassCaustics(false), flock(NULL), bubbles(NULL), crowdSize(0), seekTime(0.f)
 {
     lightDiffuseColor[0] = 0.66;
     lightDiffuseColor[1] = 1.0;
@@ -37,6 +42,14 @@ Viewer::Viewer() : currentCaustic(0), useCustomCamera(false), useCaustics(true),
     lightPosition[1] = 10.0;
     lightPosition[2] = 30.0;
     lightPosition[3] = 1.0;
+
+    // QGLViewer laisse l'ancienne caméra à détruire
+    qglviewer::Camera *old = camera();
+    fogCamera = new FogCamera(*old);
+    setCamera(fogCamera);
+    delete old;
+    fogDensity = FOG_DENSITY;
+    fogEpsilon = FOG_EPSILON;
 }
 
 Viewer::~Viewer()
@@ -51,9 +64,54 @@ Viewer::~Viewer()
     TextureManager::free();
 }
 
-void Viewer::addRenderable(Renderable *r)
+RenderableHandle Viewer::addRenderable(Renderable *r)
 {
+    uint32_t index;
+    if (freeSlots.empty()) {
+        index = slots.size();
+        slots.push_back(r);
+        generations.push_back(0);
+    } else {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+        slots[index] = r;
+    }
+    r->m_handle = RenderableHandle(index, generations[index]);
     renderableList.push_back(r);
+    return r->m_handle;
+}
+
+Renderable *Viewer::getRenderable(const RenderableHandle &h) const
+{
+    if (h.index >= slots.size() || generations[h.index] != h.generation)
+        return NULL;
+    return slots[h.index];
+}
+
+void Viewer::removeRenderable(const RenderableHandle &h)
+{
+    Renderable *r = getRenderable(h);
+    if (r)
+        r->kill();
+}
+
+void Viewer::removeDeadRenderables()
+{
+    list<Renderable *>::iterator it = renderableList.begin();
+    while (it != renderableList.end()) {
+        Renderable *r = *it;
+        if (r->isAlive()) {
+            ++it;
+            continue;
+        }
+        // les anciens handles de ce slot ne correspondent plus
+        uint32_t index = r->m_handle.index;
+        slots[index] = NULL;
+        generations[index]++;
+        freeSlots.push_back(index);
+        it = renderableList.erase(it);
+        delete r;
+    }
 }
 
 void Viewer::init()
@@ -63,6 +121,7 @@ void Viewer::init()
     //glutInit(&dum, NULL);
     // XXX WTF cet appel était en trop?
 
+    PROFILE_SCOPE("Viewer::init");
     srand(time(NULL));
     //=== VIEWING PARAMETERS
     restoreStateFromFile();   // Restore previous viewer state.
@@ -83,8 +142,11 @@ void Viewer::init()
 
     glEnable(GL_NORMALIZE); // les nomrmales ne sont plus affectées par les scale
 
+    // caustiques sur une seconde unité de texture quand c'est possible
+    singlePassCaustics = RenderQueue::hasMultitexture();
+
     // Création de la caméra et animation
-    CameraAnimation &cam = *(new CameraAnimation(30*100, *camera(), useCustomCamera));
+    CameraAnimation &cam = *(new CameraAnimation(*camera(), useCustomCamera));
 
     cam.addFrame(0, glm::vec3(-20, -BEG_DIST+10, COMMON_HEIGHT), glm::vec3(0, -BEG_DIST, COMMON_HEIGHT), true);
     cam.addFrame(30, glm::vec3(0, -BEG_DIST+20+30*SWIM_SPD, COMMON_HEIGHT+10), glm::vec3(0, -BEG_DIST+SWIM_SPD*30, COMMON_HEIGHT), true);
@@ -99,40 +161,21 @@ void Viewer::init()
     cam.addFrame(800, glm::vec3(0, -BEG_DIST+140*SWIM_SPD, COMMON_HEIGHT), glm::vec3(0, -BEG_DIST+180*SWIM_SPD+20, COMMON_HEIGHT), false);
     cam.addFrame(1000, glm::vec3(0, -BEG_DIST+140*SWIM_SPD, 7), glm::vec3(0, -BEG_DIST+150*SWIM_SPD+20, 8), true);
 
-    cam.interpolate();
-
     addRenderable(&cam);
 
     // begin with the skybox
     addRenderable(new Skybox());
 
     noise = new NoiseTerrain();
+    tiles = new TerrainTiles(noise);
     noise_zoom = 50;
     noise_persistence = 0.95;
     noise_octaves = 13;
 
-    noise->generateClouds(100, 100, noise_zoom, noise_persistence, noise_octaves);
-    addRenderable(noise);
-
-    //Corals
-    float coralOffsetX=0;
-    float coralOffsetY=0;
-    int i=0;
-    for (i=0; i < 25; i++) {
-        coralOffsetX = glm::simplex(glm::vec3(coralOffsetX*3, coralOffsetY ,1.0))*10;
-        coralOffsetY = glm::simplex(glm::vec3(coralOffsetX, coralOffsetY*10 ,1.0))*10;
-        addRenderable(new Coral(Coral::defaultDepth, coralOffsetX, coralOffsetY,
-                    Coral::randomBetween(Coral::minMult,Coral::maxMult),
-                    noise->getZ(coralOffsetX, coralOffsetY)));
-    }
-    for (i=0; i < 20; i++) {
-        coralOffsetX = (glm::simplex(glm::vec3(coralOffsetX*3, coralOffsetY ,1.0))+3)*10;
-        coralOffsetY = (glm::simplex(glm::vec3(coralOffsetX, coralOffsetY*10 ,1.0))+3)*10;
-        addRenderable(new Coral(Coral::defaultDepth, coralOffsetX+3, coralOffsetY,
-                    Coral::randomBetween(Coral::minMult,Coral::maxMult),
-                    noise->getZ(coralOffsetX, coralOffsetY)));
+    generateTerrain(true);
+    addRenderable(tiles); // dessine et détruit aussi noise
 
-    }
+    reef = addReef();
 
     //addRenderable(new objReader("models/cat.obj", "gfx/cat.png"));
     //addRenderable(new objReader("models/rpg.obj", "gfx/rpg.jpg"));
@@ -144,8 +187,13 @@ void Viewer::init()
     addRenderable(new Shark());
     guy = new Torse();
     addRenderable(guy);
+    if (crowdSize > 0)
+        addRenderable(new Crowd(crowdSize, glm::vec3(0.f, 0.f, COMMON_HEIGHT)));
     flock = new Flock(env, "fish");
     addRenderable(flock);
+    // transparentes, après tout le reste
+    bubbles = new BubbleBatch();
+    addRenderable(bubbles);
 
     //Useless XXX
     //for (int32_t y = -TERRAIN_HEIGHT/2; y < TERRAIN_HEIGHT/2; ++y) {
@@ -166,6 +214,8 @@ void Viewer::init()
     for (it = renderableList.begin(); it != renderableList.end(); ++it) {
         (*it)->init(*this);
     }
+    if (seekTime > 0.f)
+        Timeline::seek(seekTime*fps);
 
 
     glDisable(GL_LIGHT0);
@@ -200,24 +250,99 @@ void Viewer::init()
 
 
     // fog
-    fogColor[0] = 0.333;
-    fogColor[1] = 0.5;
-    fogColor[2] = 0.5;
-    fogColor[3] = 1.0;
-
-    GLfloat density = 0.0040;
+    GLfloat color[4] = { 0.333, 0.5, 0.5, 1.0 };
     glEnable (GL_FOG);
     glFogi (GL_FOG_MODE, GL_EXP2);
-    glFogfv (GL_FOG_COLOR, fogColor);
-    glFogf (GL_FOG_DENSITY, density);
     glHint (GL_FOG_HINT, GL_NICEST);
+    setFog(color, fogDensity);
 
     //addRenderable(new Weed());
 
 }
 
+void Viewer::setFog(const GLfloat color[4], float density)
+{
+    for (int i = 0; i < 4; i++)
+        fogColor[i] = color[i];
+    fogDensity = density;
+    updateFog();
+}
+
+void Viewer::setFogEpsilon(float epsilon)
+{
+    fogEpsilon = epsilon;
+    updateFog();
+}
+
+// GL_EXP2: il reste exp(-(density*z)²) de la couleur à la distance z,
+// moins que epsilon au delà de sqrt(-ln(epsilon))/density
+void Viewer::updateFog()
+{
+    glFogfv(GL_FOG_COLOR, fogColor);
+    glFogf(GL_FOG_DENSITY, fogDensity);
+    // ce que le plan lointain coupe a la couleur du brouillard
+    glClearColor(fogColor[0], fogColor[1], fogColor[2], fogColor[3]);
+    if (fogDensity > 0.f && fogEpsilon > 0.f && fogEpsilon < 1.f)
+        fogCamera->setFogDistance(sqrt(-log(fogEpsilon))/fogDensity);
+    else
+        fogCamera->setFogDistance(0.f);
+}
+
+void Viewer::generateTerrain(bool useCache)
+{
+    PROFILE_SCOPE("generate terrain");
+    // noise_zoom est donné pour une grille de 100 sommets de côté
+    double zoom = noise_zoom*TERRAIN_RES/100.0;
+    if (!useCache || !noise->load(TERRAIN_CACHE, TERRAIN_RES, TERRAIN_RES, zoom,
+                noise_persistence, noise_octaves)) {
+        noise->generateClouds(TERRAIN_RES, TERRAIN_RES, zoom, noise_persistence, noise_octaves);
+        if (useCache)
+            noise->save(TERRAIN_CACHE);
+    }
+    tiles->setParameters(TERRAIN_RES, TERRAIN_RES, zoom, noise_persistence, noise_octaves);
+
+    // les coraux ne sont plus à la surface: nouveau récif, l'ancien est
+    // supprimé entre deux images (aucun à l'initialisation)
+    if (getRenderable(reef)) {
+        removeRenderable(reef);
+        reef = addReef();
+        getRenderable(reef)->init(*this);
+    }
+}
+
+RenderableHandle Viewer::addReef()
+{
+    // positions d'abord, puis une seule requête de hauteurs pour tous
+    std::vector<float> coralX, coralY, coralZ;
+    float coralOffsetX=0;
+    float coralOffsetY=0;
+    int i=0;
+    for (i=0; i < 25; i++) {
+        coralOffsetX = glm::simplex(glm::vec3(coralOffsetX*3, coralOffsetY ,1.0))*10;
+        coralOffsetY = glm::simplex(glm::vec3(coralOffsetX, coralOffsetY*10 ,1.0))*10;
+        coralX.push_back(coralOffsetX);
+        coralY.push_back(coralOffsetY);
+    }
+    for (i=0; i < 20; i++) {
+        coralOffsetX = (glm::simplex(glm::vec3(coralOffsetX*3, coralOffsetY ,1.0))+3)*10;
+        coralOffsetY = (glm::simplex(glm::vec3(coralOffsetX, coralOffsetY*10 ,1.0))+3)*10;
+        coralX.push_back(coralOffsetX);
+        coralY.push_back(coralOffsetY);
+    }
+    coralZ.resize(coralX.size());
+    noise->getZ(&coralX[0], &coralY[0], &coralZ[0], NULL, coralX.size());
+    Reef *r = new Reef();
+    for (i=0; i < (int)coralX.size(); i++) {
+        r->addCoral(Coral(Coral::defaultDepth, coralX[i]+(i < 25 ? 0 : 3), coralY[i],
+                    Coral::randomBetween(Coral::minMult,Coral::maxMult),
+                    coralZ[i]));
+    }
+    return addRenderable(r);
+}
+
 void Viewer::loadTextures()
 {
+    PROFILE_SCOPE("load assets");
     TextureManager::loadTexture("gfx/sand1.jpg", "sand1");
     TextureManager::loadTexture("gfx/corail1.jpg", "corail1");
     TextureManager::loadTexture("gfx/weed.png", "weed");
@@ -254,6 +379,8 @@ void Viewer::loadTextures()
 
 void Viewer::draw()
 {  
+    Profiler::newFrame();
+    PROFILE_SCOPE("Viewer::draw");
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     // greenish light for the ambient
     glLightfv(GL_LIGHT2, GL_POSITION, lightPosition);
@@ -283,13 +410,54 @@ void Viewer::draw()
     // === FIRST PASS NORMAL ===
     //glDisable(GL_TEXTURE_2D);
 
-    // draw every objects in renderableList
-    list<Renderable *>::iterator it;
-    for(it = renderableList.begin(); it != renderableList.end(); ++it) {
-        (*it)->draw(PASS_NORMAL);
+    // with multitexture the caustics are modulated on the texture unit 1
+    // in the same pass, otherwise the scene is drawn a second time
+    bool singlePass = useCaustics && singlePassCaustics;
+    if (singlePass) {
+        RenderQueue::activeTexture(GL_TEXTURE1);
+        glEnable(GL_TEXTURE_2D);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+        setCausticsTexGen();
+        glBindTexture(GL_TEXTURE_2D, causticsTex[currentCaustic]);
+        RenderQueue::activeTexture(GL_TEXTURE0);
+    }
+    renderQueue.setCausticsUnit(singlePass ? GL_TEXTURE1 : 0);
+
+    // every objects in renderableList submit their draw items for both
+    // passes, sorted once by state and depth. Objects out of the camera
+    // frustum are skipped, the test is done once for both passes.
+    {
+        PROFILE_SCOPE("submit");
+        renderQueue.begin();
+        GLdouble planes[6][4];
+        camera()->getFrustumPlanesCoefficients(planes);
+        renderQueue.setFrustum(planes);
+        list<Renderable *>::iterator it;
+        glm::vec3 center;
+        float radius;
+        for(it = renderableList.begin(); it != renderableList.end(); ++it) {
+            if (!(*it)->isAlive())
+                continue;
+            if ((*it)->getBoundingSphere(center, radius) && !renderQueue.isVisible(center, radius))
+                continue;
+            (*it)->submit(renderQueue, PASS_NORMAL);
+            if (useCaustics && !singlePass)
+                (*it)->submit(renderQueue, PASS_CAUSTIC);
+        }
+        renderQueue.sort();
+    }
+    {
+        PROFILE_SCOPE("normal pass");
+        renderQueue.execute(PASS_NORMAL);
     }
 
-    if (useCaustics) {
+    if (singlePass) {
+        RenderQueue::activeTexture(GL_TEXTURE1);
+        glDisable(GL_TEXTURE_GEN_S);
+        glDisable(GL_TEXTURE_GEN_T);
+        glDisable(GL_TEXTURE_2D);
+        RenderQueue::activeTexture(GL_TEXTURE0);
+    } else if (useCaustics) {
         // === SECOND PASS CAUSTICS :3 ===
         /* Disable depth buffer update and exactly match depth
            buffer values for slightly faster rendering. */
@@ -303,39 +471,17 @@ void Viewer::draw()
         glEnable(GL_BLEND);
         glEnable(GL_TEXTURE_2D);
 
-        GLfloat sPlane[4] = { 0.05, 0.03, 0.0, 0.0 };
-        GLfloat tPlane[4] = { 0.0, 0.03, 0.05, 0.0 };
-        GLfloat causticScale = 1.0;
-
-        /* The causticScale determines how large the caustic "ripples" will
-           be.  See the "Increate/Decrease ripple size" menu options. */
-
-        sPlane[0] = 0.05 * causticScale;
-        sPlane[1] = 0.03 * causticScale;
-
-        tPlane[1] = 0.03 * causticScale;
-        tPlane[2] = 0.05 * causticScale;
-
         /* Set current color to "white" and disable lighting
            to emulate OpenGL 1.1's GL_REPLACE texture environment. */
         glColor3f(1.0, 1.0, 1.0);
         glDisable(GL_LIGHTING);
 
-        /* Generate the S & T coordinates for the caustic textures
-           from the object coordinates. */
-
-        glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
-        glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
-        glTexGenfv(GL_S, GL_OBJECT_PLANE, sPlane);
-        glTexGenfv(GL_T, GL_OBJECT_PLANE, tPlane);
-        glEnable(GL_TEXTURE_GEN_S);
-        glEnable(GL_TEXTURE_GEN_T);
-
+        setCausticsTexGen();
         glBindTexture(GL_TEXTURE_2D, causticsTex[currentCaustic]);
 
-        // draw every objects in renderableList
-        for(it = renderableList.begin(); it != renderableList.end(); ++it) {
-            (*it)->draw(PASS_CAUSTIC);
+        {
+            PROFILE_SCOPE("caustic pass");
+            renderQueue.execute(PASS_CAUSTIC);
         }
         if (toogleLight)
             glEnable(GL_LIGHTING);
@@ -350,15 +496,50 @@ void Viewer::draw()
 
 }
 
+void Viewer::setCausticsTexGen()
+{
+    GLfloat sPlane[4] = { 0.05, 0.03, 0.0, 0.0 };
+    GLfloat tPlane[4] = { 0.0, 0.03, 0.05, 0.0 };
+    GLfloat causticScale = 1.0;
+
+    /* The causticScale determines how large the caustic "ripples" will
+       be.  See the "Increate/Decrease ripple size" menu options. */
+
+    sPlane[0] = 0.05 * causticScale;
+    sPlane[1] = 0.03 * causticScale;
+
+    tPlane[1] = 0.03 * causticScale;
+    tPlane[2] = 0.05 * causticScale;
+
+    /* Generate the S & T coordinates for the caustic textures
+       from the object coordinates. */
+
+    glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
+    glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
+    glTexGenfv(GL_S, GL_OBJECT_PLANE, sPlane);
+    glTexGenfv(GL_T, GL_OBJECT_PLANE, tPlane);
+    glEnable(GL_TEXTURE_GEN_S);
+    glEnable(GL_TEXTURE_GEN_T);
+}
+
 
 void Viewer::animate()
 {
+    PROFILE_SCOPE("Viewer::animate");
     currentCaustic = (currentCaustic + 1) % NUM_PATTERNS;
     // animate every objects in renderableList
     list<Renderable *>::iterator it;
     for(it = renderableList.begin(); it != renderableList.end(); ++it) {
-        (*it)->animate();
+        if ((*it)->isAlive()) {
+            PROFILE_OBJECT(*it);
+            (*it)->animate();
+        }
+    }
+    {
+        PROFILE_SCOPE("Timeline::tick");
+        Timeline::tick();
     }
+    removeDeadRenderables();
 
     // this code might change if some rendered objets (stored as
     // attributes) need to be specifically updated with common
@@ -389,7 +570,6 @@ void Viewer::keyPressEvent(QKeyEvent *e)
     for(it = renderableList.begin(); it != renderableList.end(); ++it) {
         (*it)->keyPressEvent(e, *this);
     }
-    int s = 100;
     if ((e->key()==Qt::Key_W) && (modifiers==Qt::NoButton)) {
         // events with modifiers: CTRL+W, ALT+W, ... to handle separately
         toogleWireframe = !toogleWireframe;
@@ -407,19 +587,43 @@ void Viewer::keyPressEvent(QKeyEvent *e)
     } else if (e->key() == Qt::Key_H) {
         noise_zoom += modifiers==Qt::NoButton?-1.0:1.0;
         std::cout<<"zoom:"<<noise_zoom<<"\n";
-        noise->generateClouds(s, s, noise_zoom, noise_persistence, noise_octaves);
+        generateTerrain();
     } else if (e->key() == Qt::Key_K) {
         noise_persistence += modifiers==Qt::NoButton?-0.05:0.05;
         std::cout<<"noise_persistence:"<<noise_persistence<<"\n";
-        noise->generateClouds(s, s, noise_zoom, noise_persistence, noise_octaves);
+        generateTerrain();
     } else if (e->key() == Qt::Key_J) {
         noise_octaves += modifiers==Qt::NoButton?-1:1;
         std::cout<<"noise_octaves:"<<noise_octaves<<"\n";
-        noise->generateClouds(s, s, noise_zoom, noise_persistence, noise_octaves);
+        generateTerrain();
+    } else if (e->key() == Qt::Key_G) {
+        setFog(fogColor, fogDensity*(modifiers==Qt::NoButton ? 0.9f : 1.1f));
+        std::cout<<"fog density:"<<fogDensity<<", distance:"<<getFogDistance()<<"\n";
     } else if (e->key() == Qt::Key_C) {
         useCustomCamera = !useCustomCamera;
-    } else if (e->key() == Qt::Key_X) {
+    } else if ((e->key() == Qt::Key_X) && (modifiers==Qt::NoButton)) {
         useCaustics = !useCaustics;
+    } else if (e->key() == Qt::Key_X) {
+        // une ou deux passes pour les caustiques
+        singlePassCaustics = !singlePassCaustics && RenderQueue::hasMultitexture();
+        std::cout<<"caustics: "<<(singlePassCaustics ? "single pass" : "two passes")<<"\n";
+    } else if ((e->key() == Qt::Key_Q) && (modifiers==Qt::NoButton)) {
+        // compare les changements d'état avec et sans tri
+        std::cout<<"render queue ("<<(renderQueue.isSorted() ? "sorted" : "submission order")<<"): "
+            <<renderQueue.getNbItems()<<" items, "<<renderQueue.getTextureChanges()<<" texture binds, "
+            <<renderQueue.getMaterialChanges()<<" material changes last frame, "
+            <<renderQueue.getNbCulled()<<" culled, "<<renderQueue.getNbVisible()<<" drawn\n";
+        renderQueue.setSorted(!renderQueue.isSorted());
+    } else if ((e->key() == Qt::Key_P) && (modifiers==Qt::NoButton)) {
+        Profiler::setEnabled(!Profiler::isEnabled());
+        std::cout<<"profiler: "<<(Profiler::isEnabled() ? "on" : "off")<<"\n";
+    } else if (e->key() == Qt::Key_P) {
+        // les dernières images dans chrome://tracing
+        Profiler::dump(PROFILE_FILE);
+    } else if (e->key() == Qt::Key_T) {
+        // avance ou recule de 5 secondes dans l'histoire
+        Timeline::seek(Timeline::getTime() + (modifiers==Qt::NoButton ? 5.f : -5.f)*fps);
+        std::cout<<"time:"<<Timeline::getTime()/fps<<"s\n";
     } else {
         // if the event is not handled here, process it as default
         QGLViewer::keyPressEvent(e);
@@ -440,6 +644,7 @@ QString Viewer::helpString() const
     text += "camera path. Paths are saved when you quit the application and restored at next start.<br><br>";
     text += "Press <b>F</b> to display the frame rate, <b>A</b> for the world axis, ";
     text += "<b>Alt+Return</b> for full screen mode and <b>Control+S</b> to save a snapshot. ";
+    text += "Press <b>P</b> to start or stop the profiler and <b>Shift+P</b> to write the last frames to " PROFILE_FILE ". ";
     text += "See the <b>Keyboard</b> tab in this window for a complete shortcut list.<br><br>";
     text += "Double clicks automates single click actions: A left button double click aligns the closer axis with the camera (if close enough). ";
     text += "A middle button double click fits the zoom of the camera and the right button re-centers the scene.<br><br>";
@@ -12,14 +12,23 @@
 
 #include <QGLViewer/qglviewer.h>
 #include <list>
+#include <vector>
 #include "NoiseTerrain.hpp"
+#include "terrainTiles.hpp"
 #include "flock.hpp"
 #include "torse.hpp"
 #include "environment.hpp"
+#include "renderQueue.hpp"
+#include "fogCamera.hpp"
 #define NUM_PATTERNS 32
+#define FOG_DENSITY 0.004f
+// reste de couleur d'un objet sous lequel il est confondu avec le brouillard,
+// la dernière nuance sur 8 bits
+#define FOG_EPSILON (1.f/255.f)
 using namespace std;
 
 class Renderable;
+class BubbleBatch;
 
 
 class Viewer : public QGLViewer
@@ -28,19 +37,47 @@ class Viewer : public QGLViewer
 
         Viewer();
         virtual ~Viewer();
-        void addRenderable(Renderable *r);
+        // the viewer owns r and deletes it once it is killed
+        RenderableHandle addRenderable(Renderable *r);
+        // NULL if the renderable was removed since h was given
+        Renderable *getRenderable(const RenderableHandle &h) const;
+        // same as getRenderable(h)->kill(), ignored for a stale handle
+        void removeRenderable(const RenderableHandle &h);
+        inline uint32_t getNbRenderables() const { return renderableList.size(); }
+        /// GL_EXP2 fog, also used as the clear color. Objects farther than
+        /// getFogDistance() keep less than epsilon of their color: the far
+        /// plane of the camera is moved there, so they are culled.
+        /// Needs the GL context, after init().
+        void setFog(const GLfloat color[4], float density);
+        void setFogEpsilon(float epsilon);
+        inline float getFogDistance() const { return fogCamera->getFogDistance(); }
         double noise_zoom, noise_persistence;
         int noise_octaves;
         NoiseTerrain *noise;
+        TerrainTiles *tiles; // tuiles autour de noise, générées en arrière plan
         Flock *flock;
-    	GLfloat fogColor[4];
+        BubbleBatch *bubbles; // toutes les bulles, dessinées en dernier
+        RenderableHandle reef; // posé sur le terrain, refait avec lui
+        RenderQueue renderQueue; // refaite à chaque image par draw
+    	GLfloat fogColor[4]; // cf setFog
         bool useCustomCamera, useCaustics;
+        bool singlePassCaustics; // caustiques sur l'unité de texture 1, sinon seconde passe
         Torse *guy;
+        uint32_t crowdSize; // plongeurs en plus de guy, cf --crowd
+        float seekTime; // instant de départ de l'histoire en secondes, cf --seek
 
         /* Scene methods */
     protected :
         /// List of the scene objects, to render, animate, ...
         list<Renderable *> renderableList;
+        /// Handle slots: renderable and generation of each index, and the
+        /// indices that can be reused
+        vector<Renderable *> slots;
+        vector<uint32_t> generations;
+        vector<uint32_t> freeSlots;
+
+        /// Delete killed renderables, between two frames
+        void removeDeadRenderables();
 
         /// Create the scene and initializes rendering parameters
         virtual void init();
@@ -48,12 +85,21 @@ class Viewer : public QGLViewer
         /// Draw every objects of the scene
         virtual void draw();
 
+        /// Object linear texgen of the caustics on the active texture unit
+        void setCausticsTexGen();
+
         /// Animate every objects of the scene
         virtual void animate();
 
         // load all the textures
         void loadTextures();
 
+        // (re)génère le terrain avec les paramètres noise_*, en passant par
+        // le cache disque si useCache
+        void generateTerrain(bool useCache = false);
+        // coraux posés sur le terrain actuel
+        RenderableHandle addReef();
+
 
         /* Viewing parameters */
     protected :
@@ -64,6 +110,11 @@ class Viewer : public QGLViewer
         GLfloat lightDiffuseColor[4];
         GLfloat lightPosition[4];
         Environment env;
+        FogCamera *fogCamera; // camera()
+        float fogDensity, fogEpsilon;
+
+        /// Apply the fog parameters and update the far plane
+        void updateFog();
 
         /// Handle keyboard events specifically
         virtual void keyPressEvent(QKeyEvent *e);